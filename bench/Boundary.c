@@ -0,0 +1,196 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+*/
+
+// Microbenchmarks of the costs of crossing between wasm and JavaScript, run them with
+//   node wajic.js -bench Boundary.wasm
+// or compare the loader variants generated by wajicup.js with
+//   node bench/run.js Boundary.wasm
+// Every benchmark function returns the number of crossings it did so the results are reported per crossing.
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <wajic.h>
+
+// Number of calls done by every benchmark function (less for the large string/array sizes)
+#define CALLS 1000
+#define COUNT(size) ((size) <= 256 ? CALLS : 256 * 1024 / (size))
+
+// Maximum number of wasm memory pages added by WaBench_SbrkGrow (keep -iterations below this to only measure growing)
+#define MAX_GROW_PAGES 1024
+
+// Empty JavaScript functions with different numbers and types of arguments
+WAJIC(void, JSCall0, (), {})
+WAJIC(void, JSCallInt1, (int a), {})
+WAJIC(void, JSCallInt2, (int a, int b), {})
+WAJIC(void, JSCallInt4, (int a, int b, int c, int d), {})
+WAJIC(void, JSCallInt8, (int a, int b, int c, int d, int e, int f, int g, int h), {})
+WAJIC(void, JSCallFloat1, (float a), {})
+WAJIC(void, JSCallFloat4, (float a, float b, float c, float d), {})
+WAJIC(void, JSCallFloat8, (float a, float b, float c, float d, float e, float f, float g, float h), {})
+WAJIC(void, JSCallDouble1, (double a), {})
+WAJIC(void, JSCallDouble4, (double a, double b, double c, double d), {})
+WAJIC(void, JSCallDouble8, (double a, double b, double c, double d, double e, double f, double g, double h), {})
+WAJIC(void, JSCallI64x1, (WAi64 a), {})
+WAJIC(void, JSCallI64x4, (WAi64 a, WAi64 b, WAi64 c, WAi64 d), {})
+WAJIC(void, JSCallI64x8, (WAi64 a, WAi64 b, WAi64 c, WAi64 d, WAi64 e, WAi64 f, WAi64 g, WAi64 h), {})
+WAJIC(int, JSReturnInt, (), { return 1; })
+WAJIC(double, JSReturnDouble, (), { return 0.5; })
+
+// Strings and arrays of each size are created once so only the copying into wasm memory is measured
+WAJIC_LIB_WITH_INIT(BOUNDARY,
+(
+	var BStrs = {}, BArrs = {};
+	var BStr = size => BStrs[size] || (BStrs[size] = 'x'.repeat(size - 1));
+	var BArr = size => BArrs[size] || (BArrs[size] = new Uint8Array(size).fill(1));
+),
+void, JSStrGet, (const char* str),
+{
+	MStrGet(str);
+})
+
+WAJIC_LIB(BOUNDARY, void, JSStrGetLength, (const char* str, int length),
+{
+	MStrGet(str, length);
+})
+
+WAJIC_LIB(BOUNDARY, char*, JSStrPut, (int size),
+{
+	return MStrPut(BStr(size));
+})
+
+WAJIC_LIB(BOUNDARY, int, JSStrPutBuffer, (char* buf, int size),
+{
+	return MStrPut(BStr(size), buf, size);
+})
+
+WAJIC_LIB(BOUNDARY, char*, JSStrPutTemp, (int size),
+{
+	return MStrPutTemp(BStr(size));
+})
+
+WAJIC_LIB(BOUNDARY, void*, JSArrPut, (int size),
+{
+	return MArrPut(BArr(size));
+})
+
+WAJIC_LIB(BOUNDARY, void*, JSArrPutTemp, (int size),
+{
+	return MArrPutTemp(BArr(size));
+})
+
+// Calls a wasm export from JavaScript
+WAJIC_LIB(BOUNDARY, void, JSCallExport, (int n),
+{
+	for (var i = 0; i != n; i++) ASM.BoundaryNop(i);
+})
+
+// Reads from wasm memory with a typed array view
+WAJIC_LIB(BOUNDARY, int, JSViewRead, (const int* p, int n),
+{
+	for (var sum = 0, i = 0; i != n; i++) sum += MI32[(p>>2) + (i & 255)];
+	return sum;
+})
+
+static char text[65536 + 1], buffer[65536];
+static int nop_sum, values[256], grow_pages;
+
+// A string of size bytes including the null terminator
+static const char* Text(int size)
+{
+	if (!text[0]) memset(text, 'x', 65536);
+	return text + 65536 - (size - 1);
+}
+
+WA_EXPORT(BoundaryNop) void BoundaryNop(int i)
+{
+	nop_sum += i;
+}
+
+#define BENCH(name, call) WA_EXPORT(WaBench_##name) int WaBench_##name() { for (int i = 0; i != CALLS; i++) { call; } return CALLS; }
+#define BENCH_SIZE(name, sz, call) WA_EXPORT(WaBench_##name##_##sz) int WaBench_##name##_##sz() { int size = sz; for (int i = 0; i != COUNT(size); i++) { call; } return COUNT(size); }
+#define BENCH_SIZES(name, call) BENCH_SIZE(name, 16, call) BENCH_SIZE(name, 256, call) BENCH_SIZE(name, 4096, call) BENCH_SIZE(name, 65536, call)
+
+BENCH(Call0, JSCall0())
+BENCH(CallInt1, JSCallInt1(i))
+BENCH(CallInt2, JSCallInt2(i, i))
+BENCH(CallInt4, JSCallInt4(i, i, i, i))
+BENCH(CallInt8, JSCallInt8(i, i, i, i, i, i, i, i))
+BENCH(CallFloat1, JSCallFloat1((float)i))
+BENCH(CallFloat4, JSCallFloat4((float)i, (float)i, (float)i, (float)i))
+BENCH(CallFloat8, JSCallFloat8((float)i, (float)i, (float)i, (float)i, (float)i, (float)i, (float)i, (float)i))
+BENCH(CallDouble1, JSCallDouble1(i))
+BENCH(CallDouble4, JSCallDouble4(i, i, i, i))
+BENCH(CallDouble8, JSCallDouble8(i, i, i, i, i, i, i, i))
+BENCH(CallI64x1, JSCallI64x1(i))
+BENCH(CallI64x4, JSCallI64x4(i, i, i, i))
+BENCH(CallI64x8, JSCallI64x8(i, i, i, i, i, i, i, i))
+BENCH(ReturnInt, nop_sum += JSReturnInt())
+BENCH(ReturnDouble, nop_sum += (int)JSReturnDouble())
+
+BENCH_SIZES(StrGet, JSStrGet(Text(size)))
+BENCH_SIZES(StrGetLength, JSStrGetLength(Text(size), size - 1))
+BENCH_SIZES(StrPut, free(JSStrPut(size)))
+BENCH_SIZES(StrPutBuffer, JSStrPutBuffer(buffer, size))
+BENCH_SIZES(StrPutTemp, JSStrPutTemp(size))
+BENCH_SIZES(ArrPut, free(JSArrPut(size)))
+BENCH_SIZES(ArrPutTemp, JSArrPutTemp(size))
+
+// JavaScript to wasm calls (all from within a single wasm to JavaScript call)
+WA_EXPORT(WaBench_CallExport) int WaBench_CallExport()
+{
+	JSCallExport(CALLS);
+	return CALLS;
+}
+
+// Moving the heap end with sbrk without growing the wasm memory
+WA_EXPORT(WaBench_Sbrk) int WaBench_Sbrk()
+{
+	for (int i = 0; i != CALLS; i++) { sbrk(4096); sbrk(-4096); }
+	return CALLS * 2;
+}
+
+// Growing the wasm memory by one page with sbrk (which also recreates the typed array views in JavaScript)
+WA_EXPORT(WaBench_SbrkGrow) int WaBench_SbrkGrow()
+{
+	if (grow_pages != MAX_GROW_PAGES) { sbrk(65536); grow_pages++; }
+	return 1;
+}
+
+// Typed array view access, once with the views unchanged and once right after they have been recreated by a memory growth
+WA_EXPORT(WaBench_ViewRead) int WaBench_ViewRead()
+{
+	nop_sum += JSViewRead(values, CALLS);
+	return CALLS;
+}
+
+WA_EXPORT(WaBench_ViewReadAfterGrow) int WaBench_ViewReadAfterGrow()
+{
+	if (grow_pages != MAX_GROW_PAGES) { sbrk(65536); grow_pages++; }
+	nop_sum += JSViewRead(values, CALLS);
+	return CALLS;
+}
@@ -0,0 +1,249 @@
+/*
+  WAjic - WebAssembly JavaScript Interface Creator Benchmark Runner
+  Copyright (C) 2020 Bernhard Schelling
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+'use strict';
+
+// Runs the WaBench_ functions of a wasm file (like bench/Boundary.c) with wajic.js and with the various loaders generated by
+// wajicup.js and prints the time per operation of every benchmark for every variant side by side.
+// With -startup it instead measures the startup phases (WA.timing) of one or more wasm files (like the samples) with every variant.
+// Every variant runs in a separate Node.js process so the JIT state of one doesn't affect the others.
+
+var fs = require('fs'), path = require('path'), child_process = require('child_process');
+var root = path.join(__dirname, '..'), args = process.argv.slice(2);
+
+// The startup phases in the order they happen (parse is the time between loading the loader script and it starting to run)
+var phases = [ 'parse', 'read', 'decode', 'compile', 'eval', 'instantiate', 'data', 'ctors', 'main', 'frame' ];
+
+function ABORT(msg)
+{
+	console.error('');
+	console.error('[ERROR]');
+	console.error(msg);
+	console.error('');
+	throw process.exit(1);
+}
+
+if (args[0] == '-child') RunChild(args[1], args[2], JSON.parse(args[3]));
+else RunMain();
+
+function RunMain()
+{
+	function ShowHelp()
+	{
+		console.error('');
+		console.error('WAjic - WebAssembly JavaScript Interface Creator Benchmark Runner');
+		console.error('');
+		console.error('Usage: run.js [<switches>...] <wasm_file> [<wasm_file>...]');
+		console.error('');
+		console.error('<wasm_file> must be an unprocessed .wasm file with exported WaBench_ functions (e.g. built from bench/Boundary.c)');
+		console.error('            or any program when measuring the startup (multiple files can be passed then)');
+		console.error('');
+		console.error('<switches>');
+		console.error('  -startup:      Measure the startup phases instead of running benchmarks');
+		console.error('  -runs N:       Number of times each variant is started in startup mode (default 5, the median is shown)');
+		console.error('  -iterations N: Number of measured calls of each benchmark (default 200)');
+		console.error('  -warmup N:     Number of calls before measuring (default 10)');
+		console.error('  -filter S:     Only run the benchmarks whose name contains S');
+		console.error('  -variants L:   Comma separated list of variants to run (default all: ' + Object.keys(variants).join(',') + ')');
+		console.error('  -json P:       Write all results as JSON to path P');
+		console.error('  -keep:         Keep the generated loader files in the temporary directory');
+		console.error('  -h:            Show this help');
+		console.error('');
+		throw process.exit(0);
+	}
+
+	// The loader variants, each a list of wajicup.js arguments (or none to use the wasm file as is) and the loader that runs the result
+	var variants =
+	{
+		'wajic':          { loader: 'wajic.js' },
+		'wajic.min':      { loader: 'wajic.minified.js' },
+		'up.wasm':        { loader: 'wajic.js', up: [ 'out.wasm' ] },
+		'no_minify':      { up: [ '-node', '-no_minify', 'out.js' ] },
+		'minify':         { up: [ '-node', 'out.js' ] },
+		'js+wasm':        { up: [ '-node', 'out.js', 'out.wasm' ] },
+		'rle':            { up: [ '-node', '-rle', 'out.js' ] },
+		'base64':         { up: [ '-node', '-base64', 'out.js' ] },
+		'compressdata':   { up: [ '-node', '-compressdata', 'out.js' ] },
+	};
+
+	var opts = { iterations: 200, warmup: 10 }, wasmPaths = [], jsonPath, keep, only, runs = 5;
+	for (var i = 0; i != args.length; i++)
+	{
+		var arg = args[i], cmd = (arg[0] == '-' && arg.replace(/^-+/, '').toLowerCase());
+		if (!cmd) wasmPaths.push(arg);
+		else if (cmd == 'h' || cmd == 'help') ShowHelp();
+		else if (cmd == 'startup')    opts.startup = true;
+		else if (cmd == 'runs')       runs = parseInt(args[++i]);
+		else if (cmd == 'iterations') opts.iterations = parseInt(args[++i]);
+		else if (cmd == 'warmup')     opts.warmup = parseInt(args[++i]);
+		else if (cmd == 'filter')     opts.filter = args[++i];
+		else if (cmd == 'variants')   only = (args[++i] || '').split(',');
+		else if (cmd == 'json')       jsonPath = args[++i];
+		else if (cmd == 'keep')       keep = true;
+		else ABORT('Invalid argument: ' + arg);
+	}
+	if (!wasmPaths.length) ABORT('Missing wasm file (run with -h for help)');
+	if (wasmPaths.length > 1 && !opts.startup) ABORT('Multiple wasm files are only supported with -startup');
+	if (!(opts.iterations > 0) || !(opts.warmup >= 0) || !(runs > 0)) ABORT('Invalid number of iterations, warmup calls or runs');
+	if (only) only.forEach(v => variants[v] || ABORT('Unknown variant: ' + v));
+
+	var tmp = fs.mkdtempSync(path.join(require('os').tmpdir(), 'wajicbench-')), all = {}, allSizes = {};
+	try
+	{
+		wasmPaths.forEach((wasmPath, n) =>
+		{
+			var results = all[wasmPath] = {}, sizes = allSizes[wasmPath] = {};
+			for (var v in variants)
+			{
+				if (only && !only.includes(v)) continue;
+				var variant = variants[v], dir = path.join(tmp, n + '-' + v), wasm = wasmPath, module, js;
+				fs.mkdirSync(dir);
+				if (variant.up)
+				{
+					// Generated JavaScript loaders get the startup phase markers
+					// The input goes before the output files, generated loaders with a separate .wasm file get its path in WA.module
+					var up = variant.up.map(a => (a[0] == '-' ? a : path.join(dir, a))), outs = up.filter(a => a[0] != '-');
+					if (opts.startup && !variant.loader) up.unshift('-timing');
+					child_process.execFileSync(process.execPath, [ path.join(root, 'wajicup.js') ].concat(up.filter(a => a[0] == '-'), wasmPath, outs), { stdio: 'ignore' });
+					wasm = (variant.loader ? outs[outs.length - 1] : '');
+					module = (!variant.loader && outs.length > 1 ? outs[outs.length - 1] : undefined);
+				}
+				js = (variant.loader ? path.join(root, variant.loader) : path.join(dir, 'out.js'));
+
+				// The size of everything that needs to be shipped (the loader and the .wasm file unless it is embedded)
+				sizes[v] = [ js, wasm ].concat(variant.loader ? [] : fs.readdirSync(dir).filter(f => f != 'out.js').map(f => path.join(dir, f)))
+					.reduce((sum, f) => sum + (f ? fs.statSync(f).size : 0), 0);
+				console.log('  [RUN] ' + wasmPath + ' with ' + v + (variant.up ? ' (wajicup.js ' + variant.up.join(' ') + ')' : '') + ' ...');
+
+				for (var run = 0; run != (opts.startup ? runs : 1); run++)
+				{
+					var res = child_process.spawnSync(process.execPath, [ __filename, '-child', js, wasm, JSON.stringify(Object.assign({ module: module }, opts)) ], { encoding: 'utf8', maxBuffer: 1<<26 });
+					if (res.status && !opts.startup) ABORT('Variant ' + v + ' failed:' + "\n" + res.stdout + res.stderr);
+					if (res.status) { console.log('  [FAILED] ' + (res.stderr.trim().split("\n").pop() || 'exit code ' + res.status)); results[v] = null; break; }
+					res = JSON.parse(res.stdout.slice(res.stdout.lastIndexOf("\n{") + 1));
+					if (opts.startup) (results[v] || (results[v] = [])).push(res);
+					else results[v] = res.results;
+				}
+			}
+			if (opts.startup) PrintStartup(wasmPath, results, sizes);
+			else PrintBench(results, sizes);
+		});
+	}
+	finally
+	{
+		if (keep) console.log('  [KEPT] ' + tmp);
+		else fs.rmSync(tmp, { recursive: true, force: true });
+	}
+
+	if (jsonPath)
+	{
+		fs.writeFileSync(jsonPath, JSON.stringify({ options: opts, results: (opts.startup ? all : all[wasmPaths[0]]), sizes: (opts.startup ? allSizes : allSizes[wasmPaths[0]]) }, null, 1));
+		console.log('  [SAVED] ' + jsonPath);
+	}
+}
+
+function pad(s, n) { return (' '.repeat(n) + s).slice(-n); }
+function padEnd(s, n) { return (s + ' '.repeat(n)).slice(0, n); }
+
+// Print the median time per operation of each benchmark for all variants (and relative to the first variant) and the output sizes
+function PrintBench(results, sizes)
+{
+	var cols = Object.keys(results), names = [];
+	cols.forEach(v => results[v].forEach(r => names.includes(r.name) || names.push(r.name)));
+	console.log('');
+	console.log('  ' + padEnd('Benchmark (median ns/op)', 28) + cols.map(v => pad(v, 16)).join(''));
+	names.forEach(name =>
+	{
+		var base = results[cols[0]].find(r => r.name == name), line = '  ' + padEnd(name, 28);
+		cols.forEach(v =>
+		{
+			var r = results[v].find(r => r.name == name), ns = r && r.median_ns / r.ops;
+			line += pad(!r ? '-' : ns.toFixed(ns < 100 ? 1 : 0) + (base && v != cols[0] ? ' ' + (ns * 100 / (base.median_ns / base.ops)).toFixed(0) + '%' : ''), 16);
+		});
+		console.log(line);
+	});
+	console.log('  ' + padEnd('Size (bytes)', 28) + cols.map(v => pad(sizes[v], 16)).join(''));
+	console.log('');
+}
+
+// Print the median duration of each startup phase in milliseconds and the output size for all variants
+function PrintStartup(wasmPath, results, sizes)
+{
+	var cols = Object.keys(results), median = a => (a.sort((a, b) => a - b), a.length & 1 ? a[a.length>>1] : (a[a.length/2-1] + a[a.length/2]) / 2);
+	var Durations = t => { var res = { parse: t.parse }, last = 0; phases.slice(1).forEach(p => { if (t[p] !== undefined) { res[p] = t[p] - last; last = t[p]; } }); res.total = t.parse + last; return res; };
+	var table = {};
+	cols.forEach(v => { if (results[v]) table[v] = results[v].map(Durations); });
+	console.log('');
+	console.log('  ' + padEnd(path.basename(wasmPath) + ' (median ms)', 28) + cols.map(v => pad(v, 14)).join(''));
+	phases.concat('total').forEach(p =>
+	{
+		if (!cols.some(v => table[v] && table[v][0][p] !== undefined)) return;
+		console.log('  ' + padEnd(p, 28) + cols.map(v => pad(!table[v] ? 'failed' : table[v][0][p] === undefined ? '-' : median(table[v].map(d => d[p])).toFixed(2), 14)).join(''));
+	});
+	console.log('  ' + padEnd('size (bytes)', 28) + cols.map(v => pad(sizes[v], 14)).join(''));
+	console.log('');
+}
+
+// Load a loader script into the global scope of this process with a prepared WA object and benchmark the exports once it started
+function RunChild(jsPath, wasmPath, opts)
+{
+	var now = () => { var t = process.hrtime(); return t[0] * 1e9 + t[1]; };
+	var Done = res => process.stdout.write("\n" + JSON.stringify(res) + "\n", () => process.exit(0));
+	global.require = require;
+	global.WA =
+	{
+		module: opts.module,
+		print: msg => process.stderr.write(msg),
+		error: (code, msg) => { process.stderr.write('[ERROR] ' + code + ': ' + msg + "\n"); process.exit(1); },
+		started: () => (opts.startup ? setTimeout(() => Done(WA.timing || {}), 250) : Bench().then(results => Done({ results: results }))),
+	};
+
+	// Each measured call is followed by an await so temporary memory of MStrPutTemp/MArrPutTemp gets reset like it would between frames
+	async function Bench()
+	{
+		var asm = WA.asm, res = [];
+		for (var name of Object.keys(asm).filter(n => !n.indexOf('WaBench_') && (!opts.filter || n.includes(opts.filter))))
+		{
+			var fn = asm[name], times = [], ops = 1, total = 0, t;
+			for (var i = 0; i != opts.warmup; i++) { fn(); await null; }
+			for (var i = 0; i != opts.iterations; i++)
+			{
+				t = now();
+				ops = fn() || 1;
+				times.push(t = now() - t);
+				total += t;
+				await null;
+			}
+			times.sort((a, b) => a - b);
+			var n = times.length, mean = total / n, median = (n & 1 ? times[n>>1] : (times[n/2-1] + times[n/2]) / 2);
+			var stddev = Math.sqrt(times.reduce((sum, t) => sum + (t - mean) * (t - mean), 0) / n);
+			res.push({ name: name.slice(8), iterations: n, ops: ops, mean_ns: mean, median_ns: median, stddev_ns: stddev, min_ns: times[0] });
+		}
+		return res;
+	}
+
+	// Loaders that load the wasm file themselves (wajic.js) get the path passed like on the command line
+	if (wasmPath) process.argv = [ process.argv[0], jsPath, wasmPath ];
+	var code = fs.readFileSync(jsPath, 'utf8'), start = performance.now();
+	require('vm').runInThisContext(code, { filename: jsPath });
+	if (WA.timing) WA.timing.parse = WA.timing.start - start;
+}
@@ -0,0 +1,197 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <malloc.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// Benchmarks the memory allocator, build with ALLOCATOR=slab in wajic.mk to compare the slab allocator against emmalloc
+// Every test reports its speed and how much the heap grew (sbrk) compared to the highest amount of live memory
+
+static unsigned int rnd = 1;
+static unsigned int Rand()
+{
+	rnd ^= rnd << 13; rnd ^= rnd >> 17; rnd ^= rnd << 5;
+	return rnd;
+}
+
+static double Now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static size_t HeapEnd()
+{
+	return (size_t)sbrk(0);
+}
+
+static void Report(const char* name, double start, unsigned int allocs, size_t heap_start, size_t peak_live)
+{
+	double ms = Now() - start;
+	size_t heap_end = HeapEnd();
+	printf("%-20s %9.2f ms %8.2f M allocs/s - heap grew %7u kb - peak live %7u kb\n",
+		name, ms, allocs / ms / 1000.0, (unsigned)(heap_end > heap_start ? (heap_end - heap_start) >> 10 : 0), (unsigned)(peak_live >> 10));
+}
+
+// Many small objects (8 to 256 bytes) that get freed and allocated again in random order
+static void SmallChurn(unsigned int ops)
+{
+	enum { SLOTS = 16384 };
+	static char* slots[SLOTS];
+	static unsigned short sizes[SLOTS];
+	size_t heap_start = HeapEnd(), live = 0, peak = 0;
+	double start = Now();
+	unsigned int i, n;
+	for (n = 0; n != ops; n++)
+	{
+		i = Rand() % SLOTS;
+		if (slots[i]) { free(slots[i]); live -= sizes[i]; }
+		sizes[i] = (unsigned short)(8 + Rand() % 249);
+		slots[i] = (char*)malloc(sizes[i]);
+		slots[i][0] = (char)n;
+		if ((live += sizes[i]) > peak) peak = live;
+	}
+	for (i = 0; i != SLOTS; i++) { free(slots[i]); slots[i] = NULL; }
+	Report("Small object churn", start, ops, heap_start, peak);
+}
+
+// Arrays that grow in small steps, interleaved so the blocks can't simply grow in place
+static void ReallocGrowth(unsigned int arrays, unsigned int max_size)
+{
+	char** ptrs = (char**)calloc(arrays, sizeof(char*));
+	size_t heap_start = HeapEnd(), size, peak = 0;
+	double start = Now();
+	unsigned int i, ops = 0;
+	for (size = 64; size <= max_size; size += 64)
+	{
+		for (i = 0; i != arrays; i++, ops++)
+		{
+			ptrs[i] = (char*)realloc(ptrs[i], size);
+			ptrs[i][size - 1] = (char)i;
+		}
+		peak = size * arrays;
+	}
+	for (i = 0; i != arrays; i++) free(ptrs[i]);
+	free(ptrs);
+	Report("Realloc growth", start, ops, heap_start, peak);
+}
+
+// Simulates a long running program with each step being one second, allocating short lived objects (freed after the step),
+// objects living for up to a minute and objects living up to two hours (like cached resources)
+static void LongRunning(unsigned int hours)
+{
+	enum { MAX_OBJS = 4096, WHEEL = 8192 };
+	static struct { char* ptr; unsigned int size; int next; } objs[MAX_OBJS];
+	static int wheel[WHEEL], free_objs[MAX_OBJS];
+	char* frame[32];
+	char name[32];
+	size_t heap_start = HeapEnd(), live = 0, peak = 0;
+	double start = Now();
+	unsigned int step, steps = hours * 3600, i, ops = 0, num_free = 0;
+	int j;
+	for (j = MAX_OBJS; j--;) free_objs[num_free++] = j;
+	for (j = 0; j != WHEEL; j++) wheel[j] = -1;
+	for (step = 0; step != steps; step++)
+	{
+		for (i = 0; i != 32; i++, ops++)
+		{
+			frame[i] = (char*)malloc(16 + Rand() % 497);
+			frame[i][0] = (char)i;
+		}
+		for (i = 0; (i < 3 || (i == 3 && step % 10 == 0)) && num_free; i++, ops++)
+		{
+			// Objects are put into a timing wheel slot by the step in which they get freed
+			unsigned int r = Rand(), size = (i == 3 ? 1024 + r % (64 * 1024) : 64 + r % 4033);
+			unsigned int expire = (step + 1 + (i == 3 ? 600 + r % 6600 : r % 60)) % WHEEL;
+			j = free_objs[--num_free];
+			objs[j].ptr = (char*)malloc(size);
+			objs[j].ptr[0] = (char)j;
+			objs[j].size = size;
+			objs[j].next = wheel[expire];
+			wheel[expire] = j;
+			if ((live += size) > peak) peak = live;
+		}
+		for (i = 0; i != 32; i++) free(frame[i]);
+		for (j = wheel[step % WHEEL], wheel[step % WHEEL] = -1; j != -1; j = objs[j].next)
+		{
+			free(objs[j].ptr);
+			live -= objs[j].size;
+			free_objs[num_free++] = j;
+		}
+	}
+	for (j = 0; j != WHEEL; j++)
+		for (; wheel[j] != -1; wheel[j] = objs[wheel[j]].next)
+			free(objs[wheel[j]].ptr);
+	sprintf(name, "Long running (%uh)", hours);
+	Report(name, start, ops, heap_start, peak);
+}
+
+// Aligned allocations of all sizes, counts the returned pointers that don't have the requested alignment
+static void AlignedAllocs(unsigned int ops)
+{
+	enum { SLOTS = 1024 };
+	static void* slots[SLOTS];
+	size_t heap_start = HeapEnd(), live = 0, peak = 0, sizes[SLOTS];
+	double start = Now();
+	unsigned int i, n, misaligned = 0;
+	for (n = 0; n != ops; n++)
+	{
+		size_t alignment = (size_t)8 << (Rand() % 7), size = 1 + Rand() % (Rand() & 1 ? 256 : 16384);
+		i = Rand() % SLOTS;
+		if (slots[i]) { free(slots[i]); live -= sizes[i]; }
+		switch (n % 3)
+		{
+			case 0: slots[i] = memalign(alignment, size); break;
+			case 1: if (posix_memalign(&slots[i], alignment, size)) slots[i] = NULL; break;
+			case 2: slots[i] = aligned_alloc(alignment, (size + alignment - 1) & ~(alignment - 1)); break;
+		}
+		if ((size_t)slots[i] & (alignment - 1)) misaligned++;
+		sizes[i] = (slots[i] ? size : 0);
+		if ((live += sizes[i]) > peak) peak = live;
+	}
+	for (i = 0; i != SLOTS; i++) { free(slots[i]); slots[i] = NULL; }
+	Report("Aligned allocs", start, ops, heap_start, peak);
+	if (misaligned) printf("ERROR: %u of %u aligned allocations were misaligned\n", misaligned, ops);
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned int hours = (argc > 1 && atoi(argv[1]) > 0 ? atoi(argv[1]) : 4);
+	size_t heap_start = HeapEnd();
+	LongRunning(hours);
+	SmallChurn(4000000);
+	ReallocGrowth(512, 16384);
+	AlignedAllocs(200000);
+	printf("Total heap size: %u kb\n", (unsigned)((HeapEnd() - heap_start) >> 10));
+	return 0;
+}
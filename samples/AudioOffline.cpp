@@ -0,0 +1,76 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <wajic_audio.h>
+
+// Number of channels currently being rendered (the render function only receives the number of frames)
+static unsigned int renderChannels;
+
+// This function is called by wajic_audio.h to render a block of audio
+WA_EXPORT(RenderSynth) bool RenderSynth(float* sample_buffer, unsigned int frames)
+{
+	// Render 8 detuned sawtooth oscillators through a low pass filter per channel
+	static float phases[8][8], filter[8];
+	for (unsigned int c = 0; c < renderChannels; c++)
+	{
+		float* out = sample_buffer + c * frames;
+		for (unsigned int i = 0; i < frames; i++)
+		{
+			float mix = 0;
+			for (int v = 0; v < 8; v++)
+			{
+				float& phase = phases[c & 7][v];
+				phase += (110.0f * (1.0f + v * 0.0031f + c * 0.0017f)) / 44100.0f;
+				if (phase >= 1.0f) phase -= 1.0f;
+				mix += phase * 2.0f - 1.0f;
+			}
+			filter[c & 7] += (mix * 0.125f - filter[c & 7]) * 0.1f;
+			out[i] = tanhf(filter[c & 7] * 2.0f) * 0.25f;
+		}
+	}
+	return true;
+}
+
+// This function is called at startup
+WA_EXPORT(WajicMain) void WajicMain()
+{
+	// Render 60 seconds of audio with various block sizes and channel counts and report the throughput
+	static const unsigned int blockSizes[] = { 64, 256, 1024 }, channelCounts[] = { 1, 2, 6 };
+	for (unsigned int c : channelCounts)
+		for (unsigned int b : blockSizes)
+		{
+			renderChannels = c;
+			WaAudioRenderOffline("RenderSynth", 44100 * 60, c, 44100, b);
+		}
+
+	// Render 5 more seconds in stereo into a WAV file to check the output
+	renderChannels = 2;
+	double rtf = WaAudioRenderOffline("RenderSynth", 44100 * 5, 2, 44100, 256, "AudioOffline.wav");
+	printf("Wrote AudioOffline.wav (rendered at %.1fx realtime)\n", rtf);
+}
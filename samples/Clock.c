@@ -0,0 +1,73 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+*/
+
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <time.h>
+
+// Nanoseconds between two clock readings
+static double Diff(const struct timespec* a, const struct timespec* b)
+{
+	return (b->tv_sec - a->tv_sec) * 1e9 + (b->tv_nsec - a->tv_nsec);
+}
+
+// Measure how long a clock_gettime call takes and the smallest step between two different readings
+static void BenchClock(const char* name, clockid_t clk)
+{
+	struct timespec res, start, end, a, b;
+	double min_step = 1e9;
+	int i, n = 1000000;
+
+	clock_getres(clk, &res);
+	clock_gettime(clk, &start);
+	for (i = 0; i != n; i++) clock_gettime(clk, &a);
+	clock_gettime(clk, &end);
+
+	for (i = 0; i != 1000; i++)
+	{
+		clock_gettime(clk, &a);
+		do { clock_gettime(clk, &b); } while (b.tv_sec == a.tv_sec && b.tv_nsec == a.tv_nsec);
+		if (Diff(&a, &b) < min_step) min_step = Diff(&a, &b);
+	}
+
+	printf("%-15s - reported resolution: %ld ns - smallest observed step: %.0f ns - call overhead: %.1f ns\n",
+		name, (long)res.tv_nsec, min_step, Diff(&start, &end) / n);
+}
+
+int main(int argc, char *argv[])
+{
+	struct timespec now;
+	clock_gettime(CLOCK_REALTIME, &now);
+	printf("Realtime clock: %ld.%09ld seconds since 1970\n", (long)now.tv_sec, (long)now.tv_nsec);
+
+	BenchClock("CLOCK_REALTIME", CLOCK_REALTIME);
+	BenchClock("CLOCK_MONOTONIC", CLOCK_MONOTONIC);
+
+	clock_t c = clock();
+	printf("Processor time used: %.3f ms\n", c * 1000.0 / CLOCKS_PER_SEC);
+	return 0;
+}
@@ -26,90 +26,57 @@ For more information, please refer to <http://unlicense.org/>
 */
 
 #include <stdio.h>
-#include <wajic.h>
+#include <wajic_input.h>
 
-// This JavaScript function sets up input capturing
+static WaInputQueue* queue;
+
+// This JavaScript function sets up the canvas and calls WAFNFrame once per frame
 WAJIC(void, WASetup, (),
 {
 	var canvas = WA.canvas;
 	canvas.style.width = (canvas.width = 32) + 'px';
 	canvas.style.height = (canvas.height = 24) + 'px';
 	canvas.style.background = 'green';
-
-	var cancelEvent = function(e) { if (e.preventDefault) e.preventDefault(true); else if (e.stopPropagation) e.stopPropagation(true); else e.stopped = true; };
-	var windowEvent = function(t, f) { window.addEventListener(t, f, true); };
-	var canvasEvent = function(t, f) { canvas.addEventListener(t, f, {capture:true,passive:false}); };
-	windowEvent('keydown', function(e)
-	{
-		ASM.WAFNKey(true, e.keyCode);
-		if (e.key.length == 1) ASM.WAFNText(e.key.charCodeAt());
-		cancelEvent(e);
-	});
-	windowEvent('keyup', function(e)
-	{
-		ASM.WAFNKey(false, e.keyCode);
-		cancelEvent(e);
-	});
-	canvasEvent('mousemove', function(e)
-	{
-		ASM.WAFNMouseMove(e.offsetX * canvas.width / canvas.clientWidth , e.offsetY * canvas.height / canvas.clientHeight);
-		cancelEvent(e);
-	});
-	var buttons = 0;
-	canvasEvent('mousedown', function(e)
-	{
-		var btn = (1<<e.button);
-		if (buttons & btn) return;
-		buttons |= btn;
-		ASM.WAFNMouseButton(e.button, true);
-		cancelEvent(e);
-	});
-	windowEvent('mouseup', function(e)
-	{
-		var btn = (1<<e.button);
-		if (!(buttons & btn)) return;
-		buttons &= ~btn;
-		ASM.WAFNMouseButton(e.button, false);
-		cancelEvent(e);
-	});
-	canvasEvent('wheel',          function(e) { ASM.WAFNMouseWheel(e.deltaX, e.deltaY); cancelEvent(e); });
-	canvasEvent('DOMMouseScroll', function(e) { ASM.WAFNMouseWheel(-e.detail*40);       cancelEvent(e); });
-	windowEvent('focus',          function(e) { ASM.WAFNFocus(1); });
-	windowEvent('blur',           function(e) { ASM.WAFNFocus(0); });
+	var frame = function() { if (STOP) return; ASM.WAFNFrame(); window.requestAnimationFrame(frame); };
+	window.requestAnimationFrame(frame);
 })
 
 WA_EXPORT(WajicMain) void WajicMain()
 {
 	printf("Setting up mouse/keyboard events\n");
+	queue = WaInputInit(256);
 	WASetup();
 }
 
-WA_EXPORT(WAFNKey) void WAFNKey(int is_down, int key_code)
-{
-	printf("Key Input: %d %s\n", key_code, (is_down ? "down" : "up"));
-}
-
-WA_EXPORT(WAFNText) void WAFNText(unsigned int code)
+// Called once per frame, processes all input events queued since the last frame
+WA_EXPORT(WAFNFrame) void WAFNFrame()
 {
-	printf("Text input: %c (code %u)\n", (code >= ' ' && code <= '~' ? (char)code : '?'), code);
-}
-
-WA_EXPORT(WAFNMouseButton) void WAFNMouseButton(int button, int is_down)
-{
-	printf("Mouse Button: %d %s\n", button, (is_down ? "down" : "up"));
-}
-
-WA_EXPORT(WAFNFocus) void WAFNFocus(int focused)
-{
-	printf("Focused: %s\n", (focused ? "True" : "False"));
-}
-
-WA_EXPORT(WAFNMouseMove) void WAFNMouseMove(int x, int y)
-{
-	printf("Mouse: %d , %d\n", x, y);
-}
+	WaInputEvent events[64];
+	unsigned int i, n;
+	while ((n = WaInputDrain(queue, events, 64)) != 0)
+	{
+		for (i = 0; i != n; i++)
+		{
+			WaInputEvent* e = &events[i];
+			switch (e->type)
+			{
+				case WA_INPUT_KEY_DOWN:   printf("Key Input: %u down\n", e->code); break;
+				case WA_INPUT_KEY_UP:     printf("Key Input: %u up\n", e->code); break;
+				case WA_INPUT_TEXT:       printf("Text input: %c (code %u)\n", (e->code >= ' ' && e->code <= '~' ? (char)e->code : '?'), e->code); break;
+				case WA_INPUT_MOUSE_MOVE: printf("Mouse: %d , %d\n", (int)e->x, (int)e->y); break;
+				case WA_INPUT_MOUSE_DOWN: printf("Mouse Button: %u down\n", e->code); break;
+				case WA_INPUT_MOUSE_UP:   printf("Mouse Button: %u up\n", e->code); break;
+				case WA_INPUT_WHEEL:      printf("Mouse Wheel: X: %f - Y: %f\n", e->x, e->y); break;
+				case WA_INPUT_FOCUS:      printf("Focused: %s\n", (e->code ? "True" : "False")); break;
+			}
+		}
+	}
 
-WA_EXPORT(WAFNMouseWheel) void WAFNMouseWheel(float deltax, float deltay)
-{
-	printf("Mouse Wheel: X: %f - Y: %f\n", deltax, deltay);
+	static unsigned int lastDropped, lastCoalesced;
+	if (queue->dropped != lastDropped || queue->coalesced - lastCoalesced >= 100)
+	{
+		printf("Input queue - dropped: %u - coalesced: %u\n", queue->dropped, queue->coalesced);
+		lastDropped = queue->dropped;
+		lastCoalesced = queue->coalesced;
+	}
 }
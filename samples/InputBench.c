@@ -0,0 +1,76 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+*/
+
+#include <stdio.h>
+#include <wajic_input.h>
+
+static WaInputQueue* queue;
+static unsigned int handled;
+
+// Injects synthetic events (mostly mouse moves like a high rate mouse would) into the input queue and drains it
+// once per frame, then compares it to calling a wasm export for every single event
+WAJIC(void, JSRunBench, (unsigned int frames, unsigned int events_per_frame),
+{
+	var now = (typeof performance != 'undefined' ? performance : Date), push = WA.inputPush, i, j, t, ms;
+	var send = (f, i, j) => (j % 16 == 15 ? f(1, 32 + (j & 63), 0, 0) : j % 8 == 7 ? f(7, 0, 0, 1) : f(4, 0, j, i + j));
+	for (t = now.now(), i = 0; i != frames; i++)
+	{
+		for (j = 0; j != events_per_frame; j++) send(push, i, j);
+		ASM.WAFNDrain();
+	}
+	ms = now.now() - t;
+	WA.print('Queue:         ' + frames + ' frames with ' + events_per_frame + ' events in ' + ms.toFixed(2) + ' ms (' + (frames * events_per_frame / ms).toFixed(0) + ' events/ms, ' + frames + ' wasm calls)\n');
+
+	for (t = now.now(), i = 0; i != frames; i++)
+		for (j = 0; j != events_per_frame; j++) send(ASM.WAFNEvent, i, j);
+	ms = now.now() - t;
+	WA.print('Export calls:  ' + frames + ' frames with ' + events_per_frame + ' events in ' + ms.toFixed(2) + ' ms (' + (frames * events_per_frame / ms).toFixed(0) + ' events/ms, ' + (frames * events_per_frame) + ' wasm calls)\n');
+})
+
+// Drains all events in the queue, like an application would do once per frame
+WA_EXPORT(WAFNDrain) void WAFNDrain()
+{
+	WaInputEvent events[64];
+	unsigned int i, n;
+	while ((n = WaInputDrain(queue, events, 64)) != 0)
+		for (i = 0; i != n; i++)
+			handled += events[i].type;
+}
+
+// Handles a single event, like a separate export per event type would do
+WA_EXPORT(WAFNEvent) void WAFNEvent(unsigned int type, unsigned int code, float x, float y)
+{
+	handled += type;
+}
+
+int main(int argc, char *argv[])
+{
+	queue = WaInputInit(1024);
+	JSRunBench(10000, 100);
+	printf("Handled checksum: %u - dropped: %u - coalesced: %u\n", handled, queue->dropped, queue->coalesced);
+	return 0;
+}
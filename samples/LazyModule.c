@@ -0,0 +1,89 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+*/
+
+
+// This sample is built twice, once as the main module and once as a side module that gets loaded when it is needed:
+//   make -f wajic.mk SRC=samples/LazyModule.c MAIN_MODULE=1 MAIN_EXPORTS=printf
+//   make -f wajic.mk SRC=samples/LazyModule.c SIDE_MODULE=1
+// Then copy Release-wasm-side/LazyModule.wasm next to the main module as LazyModuleSide.wasm (or embed it with wajicup.js)
+
+#include <stdio.h>
+#include <wajic.h>
+
+#ifdef WA_SIDE_MODULE
+
+// Function pointers in static data get relocated to the function table slots of the side module when it is loaded
+typedef int (*Tool)(int value);
+static int ToolDouble(int value) { return value * 2; }
+static int ToolSquare(int value) { return value * value; }
+static const Tool Tools[] = { ToolDouble, ToolSquare };
+
+// Side modules can have their own WAJIC functions
+WAJIC(void, ShowEditor, (const char* title),
+{
+	WA.print('[Editor window "' + MStrGet(title) + '"]\n');
+})
+
+// Function exported by the main module
+WA_EXTERN int MainGetValue(void);
+
+WA_EXPORT(EditorRun) int EditorRun(int tool)
+{
+	int value = MainGetValue(), res = Tools[tool & 1](value);
+	ShowEditor("Level Editor");
+	printf("Editor applied tool %d to %d: %d\n", tool, value, res);
+	return res;
+}
+
+#else
+
+#include <wajic_module.h>
+
+WA_EXPORT(MainGetValue) int MainGetValue(void)
+{
+	return 12;
+}
+
+// This function is called when the side module has been loaded (module is 0 if it failed)
+WA_EXPORT(OnEditorLoaded) void OnEditorLoaded(int module, void* userdata)
+{
+	int (*EditorRun)(int);
+	if (!module) { printf("Could not load the editor module\n"); return; }
+
+	// Functions of a side module are called through function pointers
+	EditorRun = (int (*)(int))WaModuleSymbol(module, "EditorRun");
+	printf("Editor loaded (module %d) - result: %d\n", module, EditorRun(1));
+}
+
+int main(int argc, char *argv[])
+{
+	printf("Main module started, loading the editor only when it is needed...\n");
+	WaLoadModule("OnEditorLoaded", "LazyModuleSide.wasm", 0);
+	return 0;
+}
+
+#endif
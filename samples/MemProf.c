@@ -0,0 +1,80 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wajic_memprof.h>
+
+// Build with MEMPROF=1 to get the allocation statistics and the report of memory still allocated at exit
+
+typedef struct Entity { float pos[3], vel[3]; char* name; } Entity;
+
+static Entity* SpawnEntities(int count)
+{
+	Entity* entities = (Entity*)malloc(sizeof(Entity) * count);
+	int i;
+	for (i = 0; i != count; i++)
+	{
+		entities[i].name = (char*)malloc(16);
+		strcpy(entities[i].name, "entity");
+	}
+	return entities;
+}
+
+static void FreeEntities(Entity* entities, int count, int forget_names)
+{
+	int i;
+	for (i = 0; !forget_names && i != count; i++) free(entities[i].name);
+	free(entities);
+}
+
+int main(int argc, char *argv[])
+{
+	char* buf = NULL;
+	int i;
+
+	// Grow a buffer with realloc, like a dynamic array does
+	for (i = 1; i <= 20; i++) buf = (char*)realloc(buf, 1 << i);
+	free(buf);
+
+	// Leak the names of the second batch of entities
+	WaMemProfSetSampleRate(1);
+	FreeEntities(SpawnEntities(100), 100, 0);
+	FreeEntities(SpawnEntities(50), 50, 1);
+
+	#ifdef WA_MEMPROF
+	WaMemProfStats stats;
+	WaMemProfGetStats(&stats);
+	printf("Live: %u bytes in %u allocations - Peak: %u bytes - Allocations: %u - Frees: %u\n",
+		stats.live_bytes, stats.live_allocs, stats.peak_bytes, stats.total_allocs, stats.total_frees);
+	WaMemProfReport();
+	#else
+	printf("Build with MEMPROF=1 to enable the allocation profiler\n");
+	#endif
+	return 0;
+}
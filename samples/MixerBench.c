@@ -0,0 +1,76 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+*/
+
+#include <stdio.h>
+#include <math.h>
+#include <wajic.h>
+#include <wajic_mixer.h>
+
+// Get the current time in milliseconds with sub-millisecond precision (also available in Node.js)
+WAJIC(double, JSNow, (),
+{
+	return (typeof performance != 'undefined' ? performance : Date).now();
+})
+
+#define NUM_VOICES 64
+#define BLOCK_FRAMES 256
+#define SAMPLE_FRAMES 22050
+
+static float sample[SAMPLE_FRAMES], output[BLOCK_FRAMES * 2];
+
+static void Bench(const char* name, int interpolation)
+{
+	WaMixerVoice voices[NUM_VOICES];
+	WaMixer mixer;
+	int i, blocks = 44100 * 10 / BLOCK_FRAMES;
+	double start, ms;
+
+	// Start all voices looping with varying pitch and pan
+	WaMixerInit(&mixer, voices, NUM_VOICES, interpolation);
+	mixer.master_gain = 1.0f / NUM_VOICES;
+	for (i = 0; i != NUM_VOICES; i++)
+		WaMixerPlay(&mixer, sample, SAMPLE_FRAMES, 1.0f, (i % 9) / 4.0f - 1.0f, 0.5f + i * 0.023f, 1);
+
+	start = JSNow();
+	for (i = 0; i != blocks; i++) WaMixerMix(&mixer, output, BLOCK_FRAMES);
+	ms = JSNow() - start;
+
+	printf("%-6s %s: mixed %d voices for %d frames in %.2f ms - %.0f voice frames per ms - %.0f voices at 44100 hz realtime\n",
+		name, (WA_MIXER_SIMD ? "SIMD  " : "scalar"), NUM_VOICES, blocks * BLOCK_FRAMES, ms,
+		NUM_VOICES * (double)blocks * BLOCK_FRAMES / ms, NUM_VOICES * (double)blocks * BLOCK_FRAMES / ms / 44.1);
+}
+
+int main(int argc, char *argv[])
+{
+	// Fill the source sample with a decaying tone with some harmonics
+	for (int i = 0; i != SAMPLE_FRAMES; i++)
+		sample[i] = (sinf(i * 0.0627f) + 0.5f * sinf(i * 0.1254f) + 0.25f * sinf(i * 0.3762f)) * expf(i * -0.0002f) * 0.5f;
+
+	Bench("linear", WA_MIXER_LINEAR);
+	Bench("cubic", WA_MIXER_CUBIC);
+	return 0;
+}
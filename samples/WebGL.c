@@ -28,17 +28,13 @@ For more information, please refer to <http://unlicense.org/>
 #include <math.h>
 #include <wajic.h>
 #include <wajic_gl.h>
+#include <wajic_loop.h>
 
 WAJIC(void, JSSetupCanvas, (int width, int height),
 {
 	var canvas = WA.canvas;
 	canvas.width = width;
 	canvas.height = height;
-
-	var getDateNow = () => Date.now(), startTime = getDateNow();
-	var wafnDraw = ASM.WAFNDraw;
-	var drawFunc = function() { if (STOP) return; window.requestAnimationFrame(drawFunc); wafnDraw(getDateNow() - startTime); };
-	window.requestAnimationFrame(drawFunc);
 })
 
 static const char* vertex_shader_text =
@@ -97,13 +93,14 @@ int main(int argc, char *argv[])
 	glEnableVertexAttribArray(aCol_location);
 	glVertexAttribPointer(aCol_location, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(sizeof(float) * 2));
 
+	WaLoopStart("WAFNDraw", 0, 60, 0);
 	return 0;
 }
 
-// This function is called every frame (set up in JSSetupCanvas)
-WA_EXPORT(WAFNDraw) void WAFNDraw(int t)
+// This function is called every frame (set up with WaLoopStart)
+WA_EXPORT(WAFNDraw) void WAFNDraw(double t, float alpha)
 {
-	float f = ((t % 1000) / 1000.0f);
+	float f = (float)fmod(t / 1000.0, 1.0);
 
 	glClear(GL_COLOR_BUFFER_BIT);
 
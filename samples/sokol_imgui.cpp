@@ -37,6 +37,7 @@ SOFTWARE.
 #include "sokol_time.h"
 
 #include <wajic.h>
+#include <wajic_loop.h>
 static const char* _wa_canvas_name = 0;
 
 enum {
@@ -72,11 +73,6 @@ WAJIC(void, JSSetupCanvas, (int* width, int* height, bool fill_window), {
         canvas.height = 540;
     }
 
-    var getDateNow = () => Date.now(), startTime = getDateNow();
-    var wafnDraw = ASM.WAFNDraw;
-    var drawFunc = function() { if (STOP) return; window.requestAnimationFrame(drawFunc); wafnDraw(getDateNow() - startTime); };
-    window.requestAnimationFrame(drawFunc);
-
     MU32[width>>2] = canvas.width;
     MU32[height>>2] = canvas.height;
 })
@@ -91,13 +87,14 @@ void wa_init(const char* canvas_name, int flags) {
 typedef void (*wa_callback_func)(void);
 static wa_callback_func _wa_drawfunc;
 
-WA_EXPORT(WAFNDraw) void WAFNDraw(int t) {
+WA_EXPORT(WAFNDraw) void WAFNDraw(double t, float alpha) {
     if (_wa_drawfunc)
         _wa_drawfunc();
 }
 
 extern void wa_set_main_loop(wa_callback_func func, int fps, int simulate_infinite_loop) {
     _wa_drawfunc = func;
+    WaLoopStart("WAFNDraw", 0, 60, (fps > 0 ? fps : 0));
 }
 
 WA_EXPORT(WAFNResize) void WAFNResize(int w, int h) {
@@ -41,6 +41,19 @@
 // Macro to generate a JavaScript function that can be called from C also specifying shared init code
 #define WAJIC_LIB_WITH_INIT(lib, INIT, ret, name, args, ...) WA_EXTERN __attribute__((import_module("J"), import_name(#name "\x11" #args "\x11" #__VA_ARGS__ "\x11" #lib "\x11" #INIT))) ret name args;
 
+// Annotations for pointer parameters of WAJIC functions, in the JavaScript code the parameter then is a typed array view of count
+// elements on the wasm memory (or null for a null pointer) like 'const float* WA_F32ARRAY(values, count*4)' (count can use the other
+// parameters but needs brackets around commas), views are reused when the function gets called again with the same array
+#define WA_U8ARRAY(ptr, count) ptr
+#define WA_U16ARRAY(ptr, count) ptr
+#define WA_U32ARRAY(ptr, count) ptr
+#define WA_I32ARRAY(ptr, count) ptr
+#define WA_F32ARRAY(ptr, count) ptr
+
+// Annotations for pointer parameters of WAJIC functions to get the element index for MU16 or MU32/MI32/MF32 instead of the address
+#define WA_INDEX16(ptr) ptr
+#define WA_INDEX32(ptr) ptr
+
 // Macro to make a C function available from JavaScript
 #define WA_EXPORT(name) __attribute__((used, visibility("default"), export_name(#name)))
 
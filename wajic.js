@@ -25,6 +25,10 @@
 var print = WA.print || (WA.print = msg => console.log(msg.replace(/\n$/, '')));
 var error = WA.error || (WA.error = (code, msg) => print('[ERROR] ' + code + ': ' + msg + '\n'));
 
+// Startup phase timing, WA.timing.start is the time the loader started and the phases are set to the milliseconds since then
+var timeNow = (typeof performance != 'undefined' ? () => performance.now() : () => Date.now());
+var timing = WA.timing = { start: timeNow() }, timeMark = phase => timing[phase] = timeNow() - timing.start;
+
 // Some global state variables and max heap definition
 var WM, ASM, MEM, MU8, MU16, MU32, MI32, MF32;
 var WASM_HEAP, WASM_HEAP_MAX = (WA.maxmem||256*1024*1024); //default max 256MB
@@ -65,6 +69,83 @@ var MArrPut = function(a)
 	return ptr;
 }
 
+// Scratch memory for short-lived strings/arrays passed to wasm which stay valid until control returns to the event loop
+// (the end of the current WAJIC call, callback or frame) when the scratch memory gets reset without any calls to free
+var MTempBuf = 0, MTempSize = 0, MTempUsed = 0, MTempOld = [], MTempQueued, MTempCount = 0, MTempMallocs = 0;
+var MTempAlloc = function(len)
+{
+	if (!MTempQueued) { MTempQueued = 1; Promise.resolve().then(MTempReset); }
+	if (MTempUsed + len > MTempSize)
+	{
+		// Keep the full buffer alive until the reset as pointers into it might still be in use
+		if (MTempBuf) MTempOld.push(MTempBuf);
+		MTempSize = Math.max(MTempSize * 2, len, 65536);
+		if (!(MTempBuf = ASM.malloc(MTempSize))) return MTempSize = 0;
+		MTempUsed = 0;
+		MTempMallocs++;
+	}
+	var ptr = MTempBuf + MTempUsed;
+	MTempUsed += (len + 7) & ~7;
+	MTempCount++;
+	return ptr;
+};
+var MTempReset = function()
+{
+	MTempOld.forEach(ptr => ASM.free(ptr));
+	MTempOld = [];
+	MTempUsed = MTempQueued = 0;
+	if (MTempSize > 1048576) { ASM.free(MTempBuf); MTempBuf = MTempSize = 0; } // don't hold on to memory after large temporaries
+};
+
+// Same as MStrPut(str) and MArrPut(a) but using the scratch memory, the returned pointer must not be freed or kept
+var MStrPutTemp = function(str)
+{
+	var buf = new TextEncoder().encode(str), out = MTempAlloc(buf.length+1);
+	MU8.set(buf, out);
+	MU8[out + buf.length] = 0;
+	return out;
+};
+var MArrPutTemp = function(a)
+{
+	var len = a.byteLength || a.length, ptr = len && MTempAlloc(len);
+	MU8.set(a, ptr);
+	return ptr;
+};
+
+// Number of temporaries put into scratch memory and how many calls to malloc that avoided
+WA.tempStats = () => ({ temps: MTempCount, mallocs: MTempMallocs, avoided: MTempCount - MTempMallocs });
+
+// Get a view of len elements at index idx of a memory view for the typed array parameters of WAJIC functions (see WA_F32ARRAY)
+// Views are kept by index on the memory view so calls with the same arrays don't allocate, when the memory grows they get dropped
+var MViewCount = 0, MViewAllocs = 0;
+var MView = function(heap, idx, len)
+{
+	if (!idx) return null;
+	var views = heap.views || (heap.views = new Map()), view = views.get(idx);
+	MViewCount++;
+	if (!view || view.length != len)
+	{
+		if (views.size >= 1024) views.clear();
+		views.set(idx, view = heap.subarray(idx, idx + len));
+		MViewAllocs++;
+	}
+	return view;
+};
+
+// Number of typed array parameters passed to WAJIC functions and how many of them needed a new view
+WA.viewStats = () => ({ views: MViewCount, allocs: MViewAllocs, reused: MViewCount - MViewAllocs });
+
+// Get the current time of a clock as [seconds, nanoseconds] (clock id 0 is the realtime clock, all other ids are monotonic)
+var clockGet = function(clk)
+{
+	if (clk && (typeof process)[0]=='o') return process.hrtime();
+	var perf = (typeof performance != 'undefined' && performance), ms = (!perf ? Date.now() : clk ? perf.now() : (perf.timeOrigin || Date.now() - perf.now()) + perf.now());
+	return [Math.floor(ms / 1000), Math.floor((ms % 1000) * 1e6)];
+}, clockStart = clockGet(1);
+
+// Get the resolution of a clock in nanoseconds
+var clockRes = clk => (clk && (typeof process)[0]=='o' ? 1 : 1000);
+
 // Set the array views of various data types used to read/write to the wasm memory from JavaScript
 var MSetViews = function()
 {
@@ -76,17 +157,99 @@ var MSetViews = function()
 	MF32 = new Float32Array(buf);
 };
 
+// Decompress the data segments that wajicup.js -compressdata moved into the custom section 'wajic_data' and copy them into the wasm memory
+var MDataRestore = function(instance)
+{
+	var sec = WebAssembly.Module.customSections(WM, 'wajic_data')[0], i = 0, segs = [];
+	timeMark('instantiate');
+	if (!sec) return instance;
+	sec = new Uint8Array(sec);
+	var Get = () => { for (var b, r = 0, x = 0; r |= ((b = sec[i++])&127)<<x, b>>7; x += 7); return r; };
+	for (var n = Get(); n--;) segs.push([Get(), Get()]);
+	sec = sec.subarray(i);
+	return ((typeof process)[0]=='o' ? Promise.resolve(require('zlib').inflateSync(sec))
+		: new Response(new Response(sec).body.pipeThrough(new DecompressionStream('deflate'))).arrayBuffer()).then(data =>
+	{
+		var mem = new Uint8Array((instance.exports.memory || MEM).buffer), pos = 0;
+		data = new Uint8Array(data);
+		segs.forEach(s => mem.set(data.subarray(pos, pos += s[1]), s[0]));
+		timeMark('data');
+		return instance;
+	});
+};
+
+// Arguments passed to main after the executable name (can be set by the outer html file)
+var mainArgs = WA.args || [], bench = WA.bench;
+
 // If WA.module has not been defined, try to load a file (if running with node) or use a data attribute on the script tag
 var load = WA.module;
 if (!load)
 {
-	if ((typeof process)[0]=='o') load = require('fs').readFileSync(process.argv[2]);
+	if ((typeof process)[0]=='o')
+	{
+		// Switches before the .wasm file path set up the benchmark mode, all arguments after it are passed to main
+		var argErr = msg => { error('ARGS', msg); process.exit(1); };
+		for (var i = 2, arg; (arg = process.argv[i]) && arg[0] == '-'; i++)
+		{
+			var key = arg.slice(1);
+			bench = bench || {};
+			if (key == 'bench') continue;
+			if (!/^(filter|warmup|iterations|time|json)$/.test(key)) argErr('Unknown switch ' + arg + ' (available: -bench, -filter S, -warmup N, -iterations N, -time MS, -json PATH)');
+			if (!process.argv[i+2]) argErr('Missing value after ' + arg);
+			bench[key] = (key == 'filter' || key == 'json' ? process.argv[++i] : +process.argv[++i]);
+		}
+		if (!process.argv[i]) argErr('Usage: node wajic.js [-bench] [-filter S] [-warmup N] [-iterations N] [-time MS] [-json PATH] <file.wasm> [args...]');
+		load = require('fs').readFileSync(process.argv[i]);
+		mainArgs = process.argv.slice(i+1);
+	}
 	else load = document.currentScript.getAttribute('data-wasm')
 }
 
+// Run all exported functions named WaBench_* (optionally only ones containing bench.filter) and report timing statistics
+// Each function is called bench.warmup times (default 5) and then measured bench.iterations times or until bench.time ms
+// (default 1000) have passed (at least 10 times). If a function returns a positive number it counts as that many operations.
+var runBench = function()
+{
+	var now = ((typeof process)[0]=='o' ? () => { var t = process.hrtime(); return t[0] * 1e9 + t[1]; } : () => performance.now() * 1e6), results = [];
+	var names = Object.keys(ASM).filter(n => !n.indexOf('WaBench_') && (!bench.filter || n.includes(bench.filter)));
+	if (!names.length) abort('BENCH', 'No exported WaBench_ functions' + (bench.filter ? ' matching ' + bench.filter : ''));
+	names.forEach(name =>
+	{
+		var fn = ASM[name], warmup = (bench.warmup >= 0 ? bench.warmup : 5), times = [], ops = 1, t, total = 0;
+		while (warmup--) { fn(); MTempReset(); }
+		while (bench.iterations ? times.length < bench.iterations : times.length < 10 || total < (bench.time || 1000) * 1e6)
+		{
+			t = now();
+			ops = fn() || 1;
+			times.push(t = now() - t);
+			total += t;
+			MTempReset();
+		}
+		times.sort((a, b) => a - b);
+		var n = times.length, mean = total / n, median = (n & 1 ? times[n>>1] : (times[n/2-1] + times[n/2]) / 2);
+		var stddev = Math.sqrt(times.reduce((sum, t) => sum + (t - mean) * (t - mean), 0) / n);
+		results.push({ name: name.slice(8), iterations: n, ops: ops, mean_ns: mean, median_ns: median, stddev_ns: stddev, min_ns: times[0], ops_per_sec: ops * 1e9 / mean });
+	});
+
+	if (bench.json != '-')
+	{
+		var pad = (s, n) => (' '.repeat(n) + s).slice(-n), fmt = ns => (ns < 1e4 ? ns.toFixed(0) + ' ns' : ns < 1e7 ? (ns / 1e3).toFixed(2) + ' us' : (ns / 1e6).toFixed(2) + ' ms');
+		print('  Benchmark                       Iterations        Mean      Median      Stddev          Ops/s\n');
+		results.forEach(r => print('  ' + (r.name + ' '.repeat(30)).slice(0, 30) + pad(r.iterations, 12) + pad(fmt(r.mean_ns), 12) + pad(fmt(r.median_ns), 12) + pad(fmt(r.stddev_ns), 12) + pad(r.ops_per_sec.toFixed(r.ops_per_sec < 100 ? 2 : 0), 15) + '\n'));
+	}
+	if (bench.json)
+	{
+		var json = JSON.stringify({ args: mainArgs, results: results }, null, 1);
+		if (bench.json == '-') print(json + '\n');
+		else require('fs').writeFileSync(bench.json, json);
+	}
+	return results;
+};
+
 // Fetch the .wasm file (or use a byte buffer in WA.module directly) and compile the wasm module
-((typeof load)[0]=='s' ? fetch(load).then(r => r.arrayBuffer()) : new Promise(r => r(load))).then(wasmBuf => WebAssembly.compile(wasmBuf).then(module =>
+((typeof load)[0]=='s' ? fetch(load).then(r => r.arrayBuffer()) : new Promise(r => r(load))).then(wasmBuf => (timeMark('read'), WebAssembly.compile(wasmBuf)).then(module =>
 {
+	timeMark('compile');
 	var emptyFunction = () => 0;
 	var crashFunction = (msg) => abort('CRASH', msg);
 
@@ -108,6 +271,11 @@ if (!load)
 		time: function(ptr) { var ret = (Date.now()/1000)|0; if (ptr) MU32[ptr>>2] = ret; return ret; },
 		gettimeofday: function(ptr) { var now = Date.now(); MU32[ptr>>2]=(now/1000)|0; MU32[(ptr+4)>>2]=((now % 1000)*1000)|0; },
 
+		// Functions querying high resolution clocks (CLOCK_REALTIME with sub-millisecond precision, CLOCK_MONOTONIC and CPU time clocks)
+		clock_gettime: function(clk, ptr) { var t = clockGet(clk); MU32[ptr>>2] = t[0]; MU32[(ptr+4)>>2] = t[1]; return 0; },
+		clock_getres: function(clk, ptr) { if (ptr) { MU32[ptr>>2] = 0; MU32[(ptr+4)>>2] = clockRes(clk); } return 0; },
+		clock: function() { var t = clockGet(1); return ((t[0] - clockStart[0]) * 1e6 + (t[1] - clockStart[1]) / 1e3)|0; },
+
 		// Failed assert will abort the program
 		__assert_fail: (condition, filename, line, func) => crashFunction('assert ' + MStrGet(condition) + ' at: ' + (filename ? MStrGet(filename) : '?'), line, (func ? MStrGet(func) : '?')),
 	};
@@ -152,6 +320,16 @@ if (!load)
 				if (!JSLib) JSLib = '';
 				if (!evals[JSLib]) evals[JSLib] = '';
 
+				// turn typed array and index annotations (like 'float* WA_F32ARRAY(p, n)') into code at the start of the function
+				var JSPre = '';
+				JSArgs = JSArgs.replace(/WA_(U8|U16|U32|I32|F32)ARRAY\(([^,]*),((?:[^()]|\([^()]*\))*)\)|WA_INDEX(16|32)\(([^)]*)\)/g, (m, heap, arr, len, bits, idx) =>
+				{
+					var shift = (heap ? Math.log2(heap.slice(1) / 8) : bits / 16);
+					JSPre += (heap ? (arr = arr.trim()) + '=MView(M' + heap + ',' + arr + (shift ? '>>' + shift : '') + ',' + len + ');' : (idx = idx.trim()) + '>>=' + shift + ';');
+					return arr || idx;
+				});
+				if (JSPre) JSCode = (JSCode.match(/^\s*{/) ? JSCode.replace('{', '{' + JSPre) : '{' + JSPre + 'return(' + JSCode + ')}');
+
 				// strip C types out of params list (change '(float p1[20], unsigned int* p2[])' to 'p1,p2' (function pointers not supported)
 				JSArgs = JSArgs.replace(/^\(\s*void\s*\)$|^\(|\[.*?\]|(=|WA_ARG\()[^,]+|\)$/g, '').replace(/.*?(\w+)\s*(,|$)/g, '$1$2');
 
@@ -193,6 +371,15 @@ if (!load)
 						MU32[pOutResult>>2] = ret;
 						return 0; // no error
 					}
+					// Clock functions write a 64-bit nanosecond value (64-bit parameters can be split by wasm-opt so the pointer is always the last argument)
+					: fld == 'clock_time_get' || fld == 'clock_res_get' ?
+					function(clk)
+					{
+						var t = (fld == 'clock_res_get' ? [0, clockRes(clk)] : clockGet(clk)), ns = t[0] * 1e9 + t[1], ptr = arguments[arguments.length - 1];
+						MU32[ptr>>2] = ns % 4294967296;
+						MU32[(ptr+4)>>2] = ns / 4294967296;
+						return 0;
+					}
 					// All other IO functions are not emulated so pass empty dummies (fd_read, fd_seek, fd_close)
 					: emptyFunction);
 			}
@@ -206,6 +393,7 @@ if (!load)
 		try { (() => eval(evals[JSLib].replace(/[\0-\37]/g, m=>"\\x"+escape(m).slice(1))))(); }
 		catch (err) { abort('BOOT', 'Error in #WAJIC function: ' + err + '(' + evals[JSLib] + ')'); }
 	}
+	timeMark('eval');
 
 	// Store the module reference in WA.wm
 	WA.wm = WM = module;
@@ -213,6 +401,7 @@ if (!load)
 	// Instantiate the wasm module by passing the prepared import functions for the wasm module
 	return WebAssembly.instantiate(module, imports);
 }))
+.then(MDataRestore)
 .then(function (instance)
 {
 	// Store the list of the functions exported by the wasm module in WA.asm
@@ -235,22 +424,20 @@ if (!load)
 
 	// If function '__wasm_call_ctors' (global C++ constructors) exists, call it
 	if (wasm_call_ctors) wasm_call_ctors();
+	timeMark('ctors');
 
 	// If function 'main' exists, call it
 	if (main && malloc)
 	{
-		// Allocate 10 bytes of memory to store the argument list with 1 entry to pass to main
-		var ptr = malloc(10);
-
-		// Place executable name string "W" after the argv list
-		MU8[ptr+8] = 87;
-		MU8[ptr+9] = 0;
+		// Allocate memory to store the argument list (executable name "W" followed by mainArgs) with the strings after it
+		var args = ['W'].concat(mainArgs), argLens = args.map(a => new TextEncoder().encode(a).length + 1);
+		var ptr = malloc(args.length * 4 + 4 + argLens.reduce((a, b) => a + b)), str = ptr + args.length * 4 + 4;
 
-		// argv[0] contains the pointer to the executable name string, argv[1] has a list terminating null pointer
-		MU32[(ptr    )>>2] = (ptr + 8)
-		MU32[(ptr + 4)>>2] = 0;
+		// argv[n] contains the pointer to the argument string, argv[argc] has a list terminating null pointer
+		args.forEach((a, i) => { MU32[(ptr>>2) + i] = str; MStrPut(a, str, argLens[i]); str += argLens[i]; });
+		MU32[(ptr>>2) + args.length] = 0;
 
-		main(1, ptr);
+		main(args.length, ptr);
 	}
 	else if (main)
 	{
@@ -265,9 +452,13 @@ if (!load)
 
 	// If function 'WajicMain' exists, call it
 	if (WajicMain) WajicMain();
+	timeMark('main');
 
 	// If the outer HTML file supplied a 'started' callback, call it
 	if (started) started();
+
+	// In benchmark mode run the WaBench_ functions after everything has been set up
+	if (bench) WA.benchResults = runBench();
 })
 .catch(err =>
 {
@@ -1 +1 @@
-"use strict";var WA=WA||{};!function(){var r=WA.print||(WA.print=r=>console.log(r.replace(/\n$/,""))),e=WA.error||(WA.error=(e,t)=>r("[ERROR] "+e+": "+t+"\n")),WM,ASM,t,MU8,MU16,MU32,MI32,MF32,a,n=WA.maxmem||268435456,STOP,abort=WA.abort=(r,t)=>{throw STOP=!0,e(r,t),"abort"},MStrPut=(r,e,t)=>{if(0===t)return 0;var a=(new TextEncoder).encode(r),n=a.length,o=e||ASM.malloc(n+1);if(t&&n>=t)for(n=t-1;128==(192&a[n]);n--);return MU8.set(a.subarray(0,n),o),MU8[o+n]=0,e?n:o},MStrGet=(r,e)=>{if(0===e||!r)return"";if(!e)for(e=0;e!=r+MU8.length&&MU8[r+e];e++);return(new TextDecoder).decode(MU8.subarray(r,r+e))},MArrPut=r=>{var e=r.byteLength||r.length,t=e&&ASM.malloc(e);return MU8.set(r,t),t},o=()=>{var r=t.buffer;MU8=new Uint8Array(r),MU16=new Uint16Array(r),MU32=new Uint32Array(r),MI32=new Int32Array(r),MF32=new Float32Array(r)},i=WA.module;i||(i="o"==(typeof process)[0]?require("fs").readFileSync(process.argv[2]):document.currentScript.getAttribute("data-wasm")),("s"==(typeof i)[0]?fetch(i).then(r=>r.arrayBuffer()):new Promise(r=>r(i))).then(e=>WebAssembly.compile(e).then(i=>{var s=()=>0,l=r=>abort("CRASH",r),J={},c={sbrk:r=>{var e=a,i=e+r,s=i-t.buffer.byteLength;return i>n&&abort("MEM","Out of memory"),s>0&&(t.grow(s+65535>>16),o()),a=i,e},time:r=>{var e=Date.now()/1e3|0;return r&&(MU32[r>>2]=e),e},gettimeofday:r=>{var e=Date.now();MU32[r>>2]=e/1e3|0,MU32[r+4>>2]=e%1e3*1e3|0},__assert_fail:(r,e,t,a)=>l("assert "+MStrGet(r)+" at: "+(e?MStrGet(e):"?"),t,a?MStrGet(a):"?")},f={env:c,J:J},m={},N={};for(var u in WebAssembly.Module.imports(i).forEach(a=>{var n=a.module,o=a.name,i=a.kind[0],u=f[n]||(f[n]={});if("m"==i)for(let r,a,n,i,s,l=new Uint8Array(e),c=8,f=l.length;c<f&&(s=r=>{c+=0|r;for(var e,t,a=0;t|=(127&(e=l[c++]))<<a,e>>7;a+=7);return t},a=s(),n=s(),r=c+n,!(a<0||a>11||n<=0||r>f));c=r)if(2==a)for(n=s(),i=0;i!=n&&c<r;i++,1==a&&s(1)&&s(),2>a&&s(),3==a&&s(1))2==(a=s(s(s())))&&(t=u[o]=new WebAssembly.Memory({initial:s(1)}),c=r=f);if("f"==i){if(u==J){let[r,e,t,a,n]=o.split("");if(!t&&!n)return;a||(a=""),m[a]||(m[a]=""),e=e.replace(/^\(\s*void\s*\)$|^\(|\[.*?\]|(=|WA_ARG\()[^,]+|\)$/g,"").replace(/.*?(\w+)\s*(,|$)/g,"$1$2"),m[a]+=(n||"").replace(/^\(?\s*|\s*\)$/g,"")+"J[N."+r+"]=("+e+")=>"+t+";",N[r]=o}u!=c||c[o]||(u[o]=Math[o.replace(/^f?([^l].*?)f?$/,"$1").replace(/^rint$/,"round")]||o.match(/uncaught_excep|pure_virt|^abort$|^longjmp$/)&&(()=>l(o))||s,c[o]==s&&console.log("[WASM] Importing empty function for env."+o)),n.includes("wasi")&&(u[o]=o.includes("write")?(e,t,a,n)=>{t>>=2;for(var o=0,i="",s=0;s<a;s++){var l=MU32[t++],c=MI32[t++];if(c<0)return-1;o+=c,i+=MStrGet(l,c)}return r(i),MU32[n>>2]=o,0}:s)}}),m)try{(()=>{eval(m[u].replace(/[\0-\37]/g,r=>"\\x"+escape(r).slice(1)))})()}catch(r){abort("BOOT","Error in #WAJIC function: "+r+"("+m[u]+")")}return WA.wm=WM=i,WebAssembly.instantiate(i,f)})).then(r=>{WA.asm=ASM=r.exports;var e=ASM.memory,n=ASM.__wasm_call_ctors,i=ASM.main||ASM.__main_argc_argv,s=ASM.__original_main||ASM.__main_void,l=ASM.malloc,c=ASM.WajicMain,f=WA.started;if(e&&(t=e),t&&(o(),a=MU8.length),n&&n(),i&&l){var m=l(10);MU8[m+8]=87,MU8[m+9]=0,MU32[m>>2]=m+8,MU32[m+4>>2]=0,i(1,m)}else i&&i(0,0);s&&s(),c&&c(),f&&f()}).catch(r=>{"abort"!==r&&WA.error("BOOT","WASM instiantate error: "+r+(r.stack?"\n"+r.stack:""))})}();
\ No newline at end of file
+"use strict";var WA=WA||{};!function(){var e=WA.print||(WA.print=e=>console.log(e.replace(/\n$/,""))),r=WA.error||(WA.error=(r,t)=>e("[ERROR] "+r+": "+t+"\n")),t="undefined"!=typeof performance?()=>performance.now():()=>Date.now(),n=WA.timing={start:t()},a=e=>n[e]=t()-n.start,WM,ASM,s,MU8,MU16,MU32,MI32,MF32,o,i=WA.maxmem||268435456,STOP,abort=WA.abort=(e,t)=>{throw STOP=!0,r(e,t),"abort"},MStrPut=(e,r,t)=>{if(0===t)return 0;var n=(new TextEncoder).encode(e),a=n.length,s=r||ASM.malloc(a+1);if(t&&a>=t)for(a=t-1;128==(192&n[a]);a--);return MU8.set(n.subarray(0,a),s),MU8[s+a]=0,r?a:s},MStrGet=(e,r)=>{if(0===r||!e)return"";if(!r)for(r=0;r!=e+MU8.length&&MU8[e+r];r++);return(new TextDecoder).decode(MU8.subarray(e,e+r))},MArrPut=e=>{var r=e.byteLength||e.length,t=r&&ASM.malloc(r);return MU8.set(e,t),t},c=0,l=0,f=0,m=[],u,p=0,v=0,h=e=>{if(u||(u=1,Promise.resolve().then(g)),f+e>l){if(c&&m.push(c),l=Math.max(2*l,e,65536),!(c=ASM.malloc(l)))return l=0;f=0,v++}var r=c+f;return f+=e+7&-8,p++,r},g=()=>{m.forEach(e=>ASM.free(e)),m=[],f=u=0,l>1048576&&(ASM.free(c),c=l=0)},MStrPutTemp=e=>{var r=(new TextEncoder).encode(e),t=h(r.length+1);return MU8.set(r,t),MU8[t+r.length]=0,t},MArrPutTemp=e=>{var r=e.byteLength||e.length,t=r&&h(r);return MU8.set(e,t),t};WA.tempStats=()=>({temps:p,mallocs:v,avoided:p-v});var d=0,w=0,MView=(e,r,t)=>{if(!r)return null;var n=e.views||(e.views=new Map),a=n.get(r);return d++,a&&a.length==t||(n.size>=1024&&n.clear(),n.set(r,a=e.subarray(r,r+t)),w++),a};WA.viewStats=()=>({views:d,allocs:w,reused:d-w});var A=e=>{if(e&&"o"==(typeof process)[0])return process.hrtime();var r="undefined"!=typeof performance&&performance,t=r?e?r.now():(r.timeOrigin||Date.now()-r.now())+r.now():Date.now();return[Math.floor(t/1e3),Math.floor(t%1e3*1e6)]},_=A(1),y=e=>e&&"o"==(typeof process)[0]?1:1e3,b=()=>{var e=s.buffer;MU8=new Uint8Array(e),MU16=new Uint16Array(e),MU32=new Uint32Array(e),MI32=new Int32Array(e),MF32=new Float32Array(e)},W=e=>{var r=WebAssembly.Module.customSections(WM,"wajic_data")[0],t=0,n=[];if(a("instantiate"),!r)return e;r=new Uint8Array(r);for(var o=()=>{for(var e,n=0,a=0;n|=(127&(e=r[t++]))<<a,e>>7;a+=7);return n},i=o();i--;)n.push([o(),o()]);return r=r.subarray(t),("o"==(typeof process)[0]?Promise.resolve(require("zlib").inflateSync(r)):new Response(new Response(r).body.pipeThrough(new DecompressionStream("deflate"))).arrayBuffer()).then(r=>{var t=new Uint8Array((e.exports.memory||s).buffer),o=0;return r=new Uint8Array(r),n.forEach(e=>t.set(r.subarray(o,o+=e[1]),e[0])),a("data"),e})},M=WA.args||[],S=WA.bench,x=WA.module;if(!x)if("o"==(typeof process)[0]){for(var j=e=>{r("ARGS",e),process.exit(1)},E=2,k;(k=process.argv[E])&&"-"==k[0];E++){var $=k.slice(1);S=S||{},"bench"!=$&&(/^(filter|warmup|iterations|time|json)$/.test($)||j("Unknown switch "+k+" (available: -bench, -filter S, -warmup N, -iterations N, -time MS, -json PATH)"),process.argv[E+2]||j("Missing value after "+k),S[$]="filter"==$||"json"==$?process.argv[++E]:+process.argv[++E])}process.argv[E]||j("Usage: node wajic.js [-bench] [-filter S] [-warmup N] [-iterations N] [-time MS] [-json PATH] <file.wasm> [args...]"),x=require("fs").readFileSync(process.argv[E]),M=process.argv.slice(E+1)}else x=document.currentScript.getAttribute("data-wasm");var U=()=>{var r="o"==(typeof process)[0]?()=>{var e=process.hrtime();return 1e9*e[0]+e[1]}:()=>1e6*performance.now(),t=[],n=Object.keys(ASM).filter(e=>!e.indexOf("WaBench_")&&(!S.filter||e.includes(S.filter)));if(n.length||abort("BENCH","No exported WaBench_ functions"+(S.filter?" matching "+S.filter:"")),n.forEach(e=>{for(var n,a=ASM[e],s=S.warmup>=0?S.warmup:5,o=[],i=1,c=0;s--;)a(),g();for(;S.iterations?o.length<S.iterations:o.length<10||c<1e6*(S.time||1e3);)n=r(),i=a()||1,o.push(n=r()-n),c+=n,g();o.sort((e,r)=>e-r);var l=o.length,f=c/l,m=1&l?o[l>>1]:(o[l/2-1]+o[l/2])/2,u=Math.sqrt(o.reduce((e,r)=>e+(r-f)*(r-f),0)/l);t.push({name:e.slice(8),iterations:l,ops:i,mean_ns:f,median_ns:m,stddev_ns:u,min_ns:o[0],ops_per_sec:1e9*i/f})}),"-"!=S.json){var a=(e,r)=>(" ".repeat(r)+e).slice(-r),s=e=>e<1e4?e.toFixed(0)+" ns":e<1e7?(e/1e3).toFixed(2)+" us":(e/1e6).toFixed(2)+" ms";e("  Benchmark                       Iterations        Mean      Median      Stddev          Ops/s\n"),t.forEach(r=>e("  "+(r.name+" ".repeat(30)).slice(0,30)+a(r.iterations,12)+a(s(r.mean_ns),12)+a(s(r.median_ns),12)+a(s(r.stddev_ns),12)+a(r.ops_per_sec.toFixed(r.ops_per_sec<100?2:0),15)+"\n"))}if(S.json){var o=JSON.stringify({args:M,results:t},null,1);"-"==S.json?e(o+"\n"):require("fs").writeFileSync(S.json,o)}return t};("s"==(typeof x)[0]?fetch(x).then(e=>e.arrayBuffer()):new Promise(e=>e(x))).then(r=>(a("read"),WebAssembly.compile(r)).then(t=>{a("compile");var n=()=>0,c=e=>abort("CRASH",e),J={},l={sbrk:e=>{var r=o,t=r+e,n=t-s.buffer.byteLength;return t>i&&abort("MEM","Out of memory"),n>0&&(s.grow(n+65535>>16),b()),o=t,r},time:e=>{var r=Date.now()/1e3|0;return e&&(MU32[e>>2]=r),r},gettimeofday:e=>{var r=Date.now();MU32[e>>2]=r/1e3|0,MU32[e+4>>2]=r%1e3*1e3|0},clock_gettime:(e,r)=>{var t=A(e);return MU32[r>>2]=t[0],MU32[r+4>>2]=t[1],0},clock_getres:(e,r)=>(r&&(MU32[r>>2]=0,MU32[r+4>>2]=y(e)),0),clock:()=>{var e=A(1);return 1e6*(e[0]-_[0])+(e[1]-_[1])/1e3|0},__assert_fail:(e,r,t,n)=>c("assert "+MStrGet(e)+" at: "+(r?MStrGet(r):"?"),t,n?MStrGet(n):"?")},f={env:l,J:J},m={},N={};for(var u in WebAssembly.Module.imports(t).forEach(t=>{var a=t.module,o=t.name,i=t.kind[0],u=f[a]||(f[a]={});if("m"==i)for(let e,t,n,a,i,c=new Uint8Array(r),l=8,f=c.length;l<f&&(i=e=>{l+=0|e;for(var r,t,n=0;t|=(127&(r=c[l++]))<<n,r>>7;n+=7);return t},t=i(),n=i(),e=l+n,!(t<0||t>11||n<=0||e>f));l=e)if(2==t)for(n=i(),a=0;a!=n&&l<e;a++,1==t&&i(1)&&i(),2>t&&i(),3==t&&i(1))2==(t=i(i(i())))&&(s=u[o]=new WebAssembly.Memory({initial:i(1)}),l=e=f);if("f"==i){if(u==J){let[e,r,t,n,a]=o.split("");if(!t&&!a)return;n||(n=""),m[n]||(m[n]="");var p="";r=r.replace(/WA_(U8|U16|U32|I32|F32)ARRAY\(([^,]*),((?:[^()]|\([^()]*\))*)\)|WA_INDEX(16|32)\(([^)]*)\)/g,(e,r,t,n,a,s)=>{var o=r?Math.log2(r.slice(1)/8):a/16;return p+=r?(t=t.trim())+"=MView(M"+r+","+t+(o?">>"+o:"")+","+n+");":(s=s.trim())+">>="+o+";",t||s}),p&&(t=t.match(/^\s*{/)?t.replace("{","{"+p):"{"+p+"return("+t+")}"),r=r.replace(/^\(\s*void\s*\)$|^\(|\[.*?\]|(=|WA_ARG\()[^,]+|\)$/g,"").replace(/.*?(\w+)\s*(,|$)/g,"$1$2"),m[n]+=(a||"").replace(/^\(?\s*|\s*\)$/g,"")+"J[N."+e+"]=("+r+")=>"+t+";",N[e]=o}u!=l||l[o]||(u[o]=Math[o.replace(/^f?([^l].*?)f?$/,"$1").replace(/^rint$/,"round")]||o.match(/uncaught_excep|pure_virt|^abort$|^longjmp$/)&&(()=>c(o))||n,l[o]==n&&console.log("[WASM] Importing empty function for env."+o)),a.includes("wasi")&&(u[o]=o.includes("write")?(r,t,n,a)=>{t>>=2;for(var s=0,o="",i=0;i<n;i++){var c=MU32[t++],l=MI32[t++];if(l<0)return-1;s+=l,o+=MStrGet(c,l)}return e(o),MU32[a>>2]=s,0}:"clock_time_get"==o||"clock_res_get"==o?function(e){var r="clock_res_get"==o?[0,y(e)]:A(e),t=1e9*r[0]+r[1],n=arguments[arguments.length-1];return MU32[n>>2]=t%4294967296,MU32[n+4>>2]=t/4294967296,0}:n)}}),m)try{(()=>{eval(m[u].replace(/[\0-\37]/g,e=>"\\x"+escape(e).slice(1)))})()}catch(e){abort("BOOT","Error in #WAJIC function: "+e+"("+m[u]+")")}return a("eval"),WA.wm=WM=t,WebAssembly.instantiate(t,f)})).then(W).then(e=>{WA.asm=ASM=e.exports;var r=ASM.memory,t=ASM.__wasm_call_ctors,n=ASM.main||ASM.__main_argc_argv,i=ASM.__original_main||ASM.__main_void,c=ASM.malloc,l=ASM.WajicMain,f=WA.started;if(r&&(s=r),s&&(b(),o=MU8.length),t&&t(),a("ctors"),n&&c){var m=["W"].concat(M),u=m.map(e=>(new TextEncoder).encode(e).length+1),p=c(4*m.length+4+u.reduce((e,r)=>e+r)),v=p+4*m.length+4;m.forEach((e,r)=>{MU32[(p>>2)+r]=v,MStrPut(e,v,u[r]),v+=u[r]}),MU32[(p>>2)+m.length]=0,n(m.length,p)}else n&&n(0,0);i&&i(),l&&l(),a("main"),f&&f(),S&&(WA.benchResults=U())}).catch(e=>{"abort"!==e&&WA.error("BOOT","WASM instiantate error: "+e+(e.stack?"\n"+e.stack:""))})}();
\ No newline at end of file
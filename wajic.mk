@@ -50,6 +50,12 @@ ifeq ($(BUILD),DEBUG)
   OFLAGS    := -debug-info-kind=limited -DDEBUG -D_DEBUG
   LDFLAGS   :=
   WOPTFLAGS := -g
+else ifeq ($(BUILD),PROFILE)
+  # Optimized build with enter/exit hooks in all functions for wajic_profile.h (the name section is kept for wajicprof.js)
+  OUTDIR    := Profile-wasm
+  OFLAGS    := -Os -DNDEBUG -DWA_PROFILE -finstrument-functions-after-inlining
+  LDFLAGS   := -gc-sections
+  WOPTFLAGS := -O3 -g --legalize-js-interface --low-memory-unused --ignore-implicit-traps --converge
 else
   OUTDIR    := Release-wasm
   OFLAGS    := -Os -DNDEBUG
@@ -62,7 +68,9 @@ CXXFLAGS := -x c++ -std=c++11 -fno-rtti $(OFLAGS)
 CFLAGS   := -x c -std=c99 $(OFLAGS)
 
 # Global compiler flags for Wasm targeting
-CLANGFLAGS := -triple wasm32 -emit-obj -fcolor-diagnostics
+# The profile build needs the emscripten triple because the call site argument of the instrumentation hooks
+# (__builtin_return_address) can't be lowered otherwise, wajic_profile.h implements the emscripten_return_address it calls
+CLANGFLAGS := -triple $(if $(filter $(BUILD),PROFILE),wasm32-unknown-emscripten,wasm32) -emit-obj -fcolor-diagnostics
 CLANGFLAGS += -I${WAJIC_ROOT}
 CLANGFLAGS += -isystem$(SYSTEM_ROOT)/include/libcxx
 CLANGFLAGS += -isystem$(SYSTEM_ROOT)/include/compat
@@ -74,9 +82,87 @@ CLANGFLAGS += -mconstructor-aliases #lower .o file size
 CLANGFLAGS += -fvisibility hidden -fno-threadsafe-statics -fgnuc-version=4.2.1
 CLANGFLAGS += -D__WAJIC__ -D__EMSCRIPTEN__ -D_LIBCPP_ABI_VERSION=2
 
+# Enable WebAssembly SIMD instructions with SIMD=1 on the make command line (built into a separate output directory)
+ifeq ($(SIMD),1)
+  OUTDIR     := $(OUTDIR)-simd
+  CLANGFLAGS += -target-feature +simd128
+  WOPTFLAGS  += --enable-simd
+endif
+
+# Select the memory allocator with ALLOCATOR=slab (size class slab allocator of wajic_alloc.h) or ALLOCATOR=emmalloc (default)
+ifeq ($(ALLOCATOR),slab)
+  OUTDIR     := $(OUTDIR)-slab
+else ifneq ($(filter-out emmalloc,$(ALLOCATOR)),)
+  $(error Unknown ALLOCATOR '$(ALLOCATOR)', supported are emmalloc and slab)
+endif
+
+# Replace malloc/free with the allocation profiler of wajic_memprof.h with MEMPROF=1 (keeps function names for the call site report)
+ifeq ($(MEMPROF),1)
+  OUTDIR     := $(OUTDIR)-memprof
+  CLANGFLAGS += -DWA_MEMPROF
+  LDFLAGS    := $(filter-out -strip-all,$(LDFLAGS))
+  WOPTFLAGS  += -g
+endif
+
+# Build a main module that can load side modules with wajic_module.h with MAIN_MODULE=1 (exports the function table and stack pointer)
+# Functions and data of the main module used by side modules need WA_EXPORT or can be listed with MAIN_EXPORTS (e.g. MAIN_EXPORTS="printf strlen")
+ifeq ($(MAIN_MODULE),1)
+  OUTDIR     := $(OUTDIR)-main
+  LDFLAGS    += -export-table -growable-table -export=__stack_pointer $(MAIN_EXPORTS:%=-export=%)
+endif
+
+# Build a position independent side module to be loaded at runtime with WaLoadModule with SIDE_MODULE=1
+# It gets linked without the system library (which is used from the main module) and is not processed with wajicup.js
+ifeq ($(SIDE_MODULE),1)
+  OUTDIR     := $(OUTDIR)-side
+  CLANGFLAGS += -mrelocation-model pic -pic-level 2 -DWA_SIDE_MODULE
+  WOPTFLAGS  := $(filter-out --legalize-js-interface --low-memory-unused,$(WOPTFLAGS))
+endif
+
+# Link-time optimization across the program and the system library with LTO=full or LTO=thin (LTO=1 is the same as full)
+# Objects get compiled to LLVM bitcode and linked against bitcode archives of the system library (in system/libs-lto-full or libs-lto-thin)
+ifneq ($(LTO),)
+  LTOMODE    := $(if $(filter 1,$(LTO)),full,$(LTO))
+  ifeq ($(filter full thin,$(LTOMODE)),)
+    $(error Unknown LTO '$(LTO)', supported are full, thin and 1)
+  endif
+  OUTDIR     := $(OUTDIR)-$(if $(filter thin,$(LTOMODE)),thinlto,lto)
+  LTOFLAGS   := -emit-llvm-bc -flto=$(LTOMODE) -flto-unit
+  LDFLAGS    += $(if $(filter thin,$(LTOMODE)),--thinlto-cache-dir=$(OUTDIR)/thinlto-cache)
+endif
+
+# The system library is linked from one archive per component so wasm-ld only loads the members that are actually used
+# Variants of the system library (unoptimized with debug info with SYSTEM_DEBUG=1, SIMD and LTO) get built into separate directories
+# Without any archives and without system sources to build them from (like with the download), the prebuilt system.bc gets linked
+SYS_VARIANT := $(if $(filter 1,$(SYSTEM_DEBUG)),-debug)$(if $(filter 1,$(SIMD)),-simd)$(if $(LTOMODE),-lto-$(LTOMODE))
+SYS_LIBDIR := $(WAJIC_ROOT)system/libs$(SYS_VARIANT)
+SYS_LIBS   := $(SYS_LIBDIR)/libc.a $(SYS_LIBDIR)/libc++.a $(SYS_LIBDIR)/libc++abi.a $(SYS_LIBDIR)/libcompiler_rt.a $(SYS_LIBDIR)/libmalloc.a
+SYSTEM_LIB := $(SYS_LIBS)
+ifeq ($(LTOMODE)$(filter 1,$(SYSTEM_DEBUG))$(wildcard $(SYS_LIBS) $(SYSTEM_ROOT)/lib/libc/musl/src),)
+  SYSTEM_LIB := $(WAJIC_ROOT)system/system.bc
+endif
+
+# Profile-guided optimization, first build with PGO=instrument and run the program (under Node.js the profile counters get written
+# to default.profraw or LLVM_PROFILE_FILE on exit by wajic_pgo.h), then build with PGO=use which merges all .profraw files in the
+# current directory into PGO_PROFILE (default.profdata) with llvm-profdata and optimizes the program sources with it
+# Value profiling is disabled because it would need the functions of the LLVM profile runtime
+ifeq ($(PGO),instrument)
+  OUTDIR     := $(OUTDIR)-pgoinst
+  PGOFLAGS   := -fprofile-instrument=llvm -mllvm -disable-vp=true
+else ifeq ($(PGO),use)
+  OUTDIR     := $(OUTDIR)-pgo
+  PGO_PROFILE ?= default.profdata
+  PGOFLAGS   := -fprofile-instrument-use-path=$(PGO_PROFILE) -Wno-profile-instr-out-of-date -Wno-profile-instr-unprofiled
+else ifneq ($(PGO),)
+  $(error Unknown PGO '$(PGO)', supported are instrument and use)
+endif
+
 # Flags for wasm-ld
 LDFLAGS += -no-entry -allow-undefined
 LDFLAGS += -export=__wasm_call_ctors -export=main -export=__original_main -export=__main_argc_argv -export=__main_void -export=malloc -export=free
+ifeq ($(SIDE_MODULE),1)
+  LDFLAGS := $(filter-out -no-entry -allow-undefined -export=%,$(LDFLAGS)) -shared -experimental-pic
+endif
 
 # Project Build flags, add defines from the make command line (e.g. D=MACRO=VALUE)
 FLAGS := $(subst \\\, ,$(foreach F,$(subst \ ,\\\,$(D)),"-D$(F)"))
@@ -85,7 +171,7 @@ FLAGS := $(subst \\\, ,$(foreach F,$(subst \ ,\\\,$(D)),"-D$(F)"))
 SOURCES := $(if $(SRC),$(wildcard $(SRC)),$(wildcard *.c *.cpp *.cc))
 -include sources.mk
 SOURCES += $(foreach F, $(ADD_SOURCES), $(wildcard $(F)))
-ifeq ($(SOURCES),)
+ifeq ($(SOURCES)$(filter system,$(MAKECMDGOALS)),)
   $(error No source files found for build)
 endif
 OUTBASE := $(OUTDIR)/$(if $(SRC),$(basename $(notdir $(firstword $(SRC)))),output)
@@ -101,9 +187,14 @@ endif
 # Surround used commands with double quotes
 CC := "$(LLVM_ROOT)/clang" -cc1
 LD := "$(LLVM_ROOT)/wasm-ld"
+AR := "$(LLVM_ROOT)/llvm-ar"
+PROFDATA := "$(LLVM_ROOT)/llvm-profdata"
 
 all: $(OUTBASE).wasm
-.PHONY: clean
+.PHONY: clean system
+
+# Build the system library archives without building a program (make -f wajic.mk system)
+system: $(SYSTEM_LIB)
 
 clean:
 	$(info Removing all build files ...)
@@ -112,26 +203,68 @@ clean:
 # Generate a list of .o files to build, include dependency rules for source files, then compile files
 OBJS := $(addprefix $(OUTDIR)/,$(notdir $(patsubst %.c,%.o,$(patsubst %.cpp,%.o,$(patsubst %.cc,%.o,$(SOURCES))))))
 -include $(OBJS:%.o=%.d)
-MAKEOBJ = $(OUTDIR)/$(basename $(notdir $(1))).o: $(1) ; $$(call COMPILE,$$@,$$<,$(2),$(3) $$(FLAGS))
+MAKEOBJ = $(OUTDIR)/$(basename $(notdir $(1))).o: $(1) $(PGO_PROFILE) ; $$(call COMPILE,$$@,$$<,$(2),$(3) $$(FLAGS) $$(PGOFLAGS))
 $(foreach F,$(filter %.cc ,$(SOURCES)),$(eval $(call MAKEOBJ,$(F),$$(CC),$$(CXXFLAGS))))
 $(foreach F,$(filter %.cpp,$(SOURCES)),$(eval $(call MAKEOBJ,$(F),$$(CC),$$(CXXFLAGS))))
 $(foreach F,$(filter %.c  ,$(SOURCES)),$(eval $(call MAKEOBJ,$(F),$$(CC),$$(CFLAGS))))
 
-$(OUTBASE).wasm : $(OBJS) $(WAJIC_ROOT)system/system.bc $(THIS_MAKEFILE)
+# The profile build links in the event recording hooks implemented in wajic_profile.h
+ifeq ($(BUILD),PROFILE)
+OBJS += $(OUTDIR)/wajic_profile.o
+$(OUTDIR)/wajic_profile.o : $(WAJIC_ROOT)wajic_profile.h ; $(call COMPILE,$@,$<,$(CC),$(CFLAGS) $(FLAGS) -DWA_PROFILE_IMPLEMENTATION)
+endif
+
+# The slab allocator build links in the malloc/free replacements implemented in wajic_alloc.h
+ifeq ($(ALLOCATOR),slab)
+OBJS += $(OUTDIR)/wajic_alloc.o
+$(OUTDIR)/wajic_alloc.o : $(WAJIC_ROOT)wajic_alloc.h ; $(call COMPILE,$@,$<,$(CC),$(CFLAGS) $(FLAGS) -DWA_ALLOC_IMPLEMENTATION)
+MEMPROF_WRAP := -DWA_MEMPROF_MALLOC=WaAllocMalloc -DWA_MEMPROF_MEMALIGN=WaAllocMemalign -DWA_MEMPROF_REALLOC=WaAllocRealloc -DWA_MEMPROF_FREE=WaAllocFree
+endif
+
+# The allocation profiler build links in the malloc/free replacements implemented in wajic_memprof.h (wrapping the selected allocator)
+ifeq ($(MEMPROF),1)
+OBJS += $(OUTDIR)/wajic_memprof.o
+$(OUTDIR)/wajic_memprof.o : $(WAJIC_ROOT)wajic_memprof.h ; $(call COMPILE,$@,$<,$(CC),$(CFLAGS) $(FLAGS) $(MEMPROF_WRAP) -DWA_MEMPROF_IMPLEMENTATION)
+endif
+
+# The instrumented build links in the profile counter writer implemented in wajic_pgo.h
+ifeq ($(PGO),instrument)
+OBJS += $(OUTDIR)/wajic_pgo.o
+$(OUTDIR)/wajic_pgo.o : $(WAJIC_ROOT)wajic_pgo.h ; $(call COMPILE,$@,$<,$(CC),$(CFLAGS) $(FLAGS) -DWA_PGO_IMPLEMENTATION)
+endif
+
+# The profile gets merged from the raw profiles written by running the instrumented build
+ifeq ($(PGO),use)
+$(PGO_PROFILE) : $(wildcard *.profraw)
+	$(if $^,,$(error No .profraw files found to create $@, build with PGO=instrument and run the program first))
+	$(info Merging profiles into $@ ...)
+	@$(PROFDATA) merge -o $@ $^
+endif
+
+ifeq ($(SIDE_MODULE),1)
+$(OUTBASE).wasm : $(OBJS) $(THIS_MAKEFILE)
+	$(info Linking side module $@ ...)
+	@$(LD) $(LDFLAGS) $(OBJS) -o $@
+	@$(if $(WASMOPT),"$(WASMOPT)" $(WOPTFLAGS) $@ -o $@)
+else
+$(OUTBASE).wasm : $(OBJS) $(SYSTEM_LIB) $(THIS_MAKEFILE)
 	$(info Linking $@ ...)
-	@$(LD) $(LDFLAGS) $(WAJIC_ROOT)system/system.bc $(OBJS) -o $@
+	@$(LD) $(LDFLAGS) $(SYSTEM_LIB) $(OBJS) -o $@
 	@$(if $(WASMOPT),"$(WASMOPT)" --legalize-js-interface $(WOPTFLAGS) $@ -o $@)
 	@$(if $(NODE),"$(NODE)" "$(WAJIC_ROOT)wajicup.js" $(if $(filter $(BUILD),DEBUG),-nominify )$@ $@)
+endif
 
 define COMPILE
 	$(info $2)
 	@$(if $(wildcard $(dir $1)),,$(shell mkdir "$(dir $1)"))
-	@$3 $(CLANGFLAGS) $4 -dependency-file $(patsubst %.o,%.d,$1) -MT $1 -MP -o $1 $2
+	@$3 $(CLANGFLAGS) $(LTOFLAGS) $4 -dependency-file $(patsubst %.o,%.d,$1) -MT $1 -MP -o $1 $2
 endef
 
 #------------------------------------------------------------------------------------------------------
-#if system.bc exists, don't even bother checking sources, build once and forget for now
-ifeq ($(if $(wildcard $(WAJIC_ROOT)system/system.bc),1,0),0)
+#if the system sources are available, the system archives get updated incrementally (otherwise use the existing archives or system.bc)
+#side modules don't link the system library, skip it so side builds don't change the flags that the main build tracks
+ifneq ($(SIDE_MODULE),1)
+ifneq ($(filter-out $(wildcard $(SYSTEM_LIB)),$(SYSTEM_LIB))$(wildcard $(SYSTEM_ROOT)/lib/libc/musl/src),)
 SYS_ADDS := emmalloc.cpp libcxx/*.cpp libcxxabi/src/cxa_guard.cpp compiler-rt/lib/builtins/*.c libc/wasi-helpers.c
 SYS_MUSL := complex crypt ctype dirent errno fcntl fenv internal locale math misc mman multibyte prng regex select stat stdio stdlib string termios unistd
 #SYS_MUSL += compat-emscripten time #uncomment if you need time formatting and C++ streams and locale
@@ -155,32 +288,67 @@ ifeq ($(if $(SYS_MISSING),1,0),1)
   $(error SYS_SOURCES missing the following files in $(SYSTEM_ROOT)/lib: $(SYS_MISSING))
 endif
 
-SYS_OLDFILES := $(filter-out $(subst /,!,$(patsubst %.c,%.o,$(patsubst %.cpp,%.o,$(SYS_SOURCES)))),$(notdir $(wildcard temp/*.o)))
-$(foreach F,$(SYS_OLDFILES),$(shell $(if $(ISWIN),del "temp\,rm "temp/)$(F)" $(PIPETONULL)))
+# Objects are kept next to the archives of the variant in a subdirectory per component archive (named like the archive without lib and .a)
+# Sources and objects use absolute paths so the dependency files stay valid no matter from which directory a program is built
+SYS_ROOT      := $(abspath $(SYSTEM_ROOT))
+SYS_OBJDIR    := $(abspath $(SYS_LIBDIR))/obj
+SYS_COMPONENT  = $(if $(filter libcxxabi/%,$1),c++abi,$(if $(filter libcxx/%,$1),c++,$(if $(filter compiler-rt/%,$1),compiler_rt,$(if $(filter libc/%,$1),c,malloc))))
+SYS_OBJ        = $(SYS_OBJDIR)/$(call SYS_COMPONENT,$1)/$(subst /,!,$(basename $1)).o
+SYS_CPP_OBJS  := $(foreach S,$(filter %.cpp,$(SYS_SOURCES)),$(call SYS_OBJ,$(S)))
+SYS_CC_OBJS   := $(foreach S,$(filter   %.c,$(SYS_SOURCES)),$(call SYS_OBJ,$(S)))
+
+# Remove objects of sources that are no longer part of the system library together with the archives that contain them
+SYS_OLDFILES := $(filter-out $(SYS_CPP_OBJS) $(SYS_CC_OBJS),$(wildcard $(SYS_OBJDIR)/*/*.o))
+SYS_OLDLIBS  := $(sort $(foreach F,$(SYS_OLDFILES),$(wildcard $(SYS_LIBDIR)/lib$(word 1,$(subst /, ,$(patsubst $(SYS_OBJDIR)/%,%,$(F)))).a)))
+$(foreach F,$(SYS_OLDFILES:%.o=%.d) $(SYS_OLDFILES) $(SYS_OLDLIBS),$(shell $(if $(ISWIN),del "$(subst /,\,$(F))",rm -f "$(F)") $(PIPETONULL)))
+-include $(SYS_CPP_OBJS:%.o=%.d) $(SYS_CC_OBJS:%.o=%.d)
 
-SYS_CXXFLAGS := -x c++ -std=c++11 -Os -fno-threadsafe-statics -fno-rtti -I$(SYSTEM_ROOT)/lib/libcxxabi/include
-SYS_CXXFLAGS += -DNDEBUG -D_LIBCPP_BUILDING_LIBRARY -D_LIBCPP_DISABLE_VISIBILITY_ANNOTATIONS
+# The system library is always built for the plain wasm32 target without the program specific defines and include paths
+SYS_CLANGFLAGS := $(subst -isystem$(SYSTEM_ROOT)/,-isystem$(SYS_ROOT)/,$(subst wasm32-unknown-emscripten,wasm32,$(filter-out -I$(WAJIC_ROOT) -DWA_%,$(CLANGFLAGS))))
+SYS_OFLAGS     := $(if $(filter 1,$(SYSTEM_DEBUG)),-debug-info-kind=limited,-Os -DNDEBUG)
 
-SYS_CFLAGS := -x c -std=gnu99 -Os -fno-threadsafe-statics -fno-builtin
-SYS_CFLAGS += -DNDEBUG -Dunix -D__unix -D__unix__ -D_XOPEN_SOURCE
-SYS_CFLAGS += -isystem$(SYSTEM_ROOT)/lib/libc/musl/src/internal
+SYS_CXXFLAGS := -x c++ -std=c++11 $(SYS_OFLAGS) -fno-threadsafe-statics -fno-rtti -I$(SYS_ROOT)/lib/libcxxabi/include
+SYS_CXXFLAGS += -D_LIBCPP_BUILDING_LIBRARY -D_LIBCPP_DISABLE_VISIBILITY_ANNOTATIONS
+
+SYS_CFLAGS := -x c -std=gnu99 $(SYS_OFLAGS) -fno-threadsafe-statics -fno-builtin
+SYS_CFLAGS += -Dunix -D__unix -D__unix__ -D_XOPEN_SOURCE
+SYS_CFLAGS += -isystem$(SYS_ROOT)/lib/libc/musl/src/internal
 SYS_CFLAGS += -Wno-dangling-else -Wno-ignored-attributes -Wno-bitwise-op-parentheses -Wno-logical-op-parentheses -Wno-shift-op-parentheses -Wno-string-plus-int
 SYS_CFLAGS += -Wno-unknown-pragmas -Wno-shift-count-overflow -Wno-return-type -Wno-macro-redefined -Wno-unused-result -Wno-pointer-sign -Wno-implicit-function-declaration
 
-SYS_CPP_OBJS := $(addprefix temp/,$(subst /,!,$(patsubst %.cpp,%.o,$(filter %.cpp,$(SYS_SOURCES)))))
-SYS_CC_OBJS  := $(addprefix temp/,$(subst /,!,$(patsubst   %.c,%.o,$(filter   %.c,$(SYS_SOURCES)))))
-$(SYS_CPP_OBJS) : ; $(call SYS_COMPILE,$@,$(subst !,/,$(patsubst temp/%.o,$(SYSTEM_ROOT)/lib/%.cpp,$@)),$(CC),$(SYS_CXXFLAGS))
-$(SYS_CC_OBJS)  : ; $(call SYS_COMPILE,$@,$(subst !,/,$(patsubst temp/%.o,$(SYSTEM_ROOT)/lib/%.c,$@)),$(CC),$(SYS_CFLAGS))
+# Functions that the code generator can emit calls to (compiler-rt builtins, memcpy/memmove/memset and math) stay regular
+# objects in the LTO archive because libcalls defined in bitcode can't be resolved anymore after the LTO code generation
+SYS_NOLTO := $(addprefix $(SYS_ROOT)/lib/,compiler-rt/% libc/musl/src/math/% libc/musl/src/string/memcpy.c libc/musl/src/string/memmove.c libc/musl/src/string/memset.c)
+
+# The flags of each language are stored next to the objects and get rewritten when they change which rebuilds all objects of that language
+# The flags files are checked on every run but only written when the flags differ, so their time stamp only changes with the flags
+SYS_READFILE   = $(strip $(shell $(if $(ISWIN),type "$(subst /,\,$1)" 2>nul,cat "$1" 2>/dev/null)))
+SYS_DIFFERENT  = $(filter-out $1,$2)$(filter-out $2,$1)
+$(SYS_OBJDIR)/cxxflags.txt : SYS_FLAGS = $(SYS_CXXFLAGS) $(SYS_CLANGFLAGS) $(LTOFLAGS)
+$(SYS_OBJDIR)/cflags.txt   : SYS_FLAGS = $(SYS_CFLAGS) $(SYS_CLANGFLAGS) $(LTOFLAGS)
+$(SYS_OBJDIR)/cxxflags.txt $(SYS_OBJDIR)/cflags.txt : FORCE
+	$(if $(call SYS_DIFFERENT,$(call SYS_READFILE,$@),$(SYS_FLAGS)),$(info Updating $@ ...))
+	@$(if $(call SYS_DIFFERENT,$(call SYS_READFILE,$@),$(SYS_FLAGS)),$(if $(ISWIN),mkdir "$(subst /,\,$(SYS_OBJDIR))" $(PIPETONULL) & echo $(strip $(SYS_FLAGS))> "$(subst /,\,$@)",mkdir -p "$(SYS_OBJDIR)" && echo '$(strip $(SYS_FLAGS))' > "$@"))
+FORCE:
+
+# Each object depends on its source and the flags (headers are added by the included dependency files)
+$(foreach S,$(filter %.cpp,$(SYS_SOURCES)),$(eval $(call SYS_OBJ,$(S)) : $(SYS_ROOT)/lib/$(S) $(SYS_OBJDIR)/cxxflags.txt))
+$(foreach S,$(filter   %.c,$(SYS_SOURCES)),$(eval $(call SYS_OBJ,$(S)) : $(SYS_ROOT)/lib/$(S) $(SYS_OBJDIR)/cflags.txt))
+$(SYS_CPP_OBJS) : ; $(call SYS_COMPILE,$@,$(SYS_ROOT)/lib/$(subst !,/,$(basename $(notdir $@))).cpp,$(CC),$(SYS_CXXFLAGS))
+$(SYS_CC_OBJS)  : ; $(call SYS_COMPILE,$@,$(SYS_ROOT)/lib/$(subst !,/,$(basename $(notdir $@))).c,$(CC),$(SYS_CFLAGS))
 
 define SYS_COMPILE
 	$(info $2)
-	@$(if $(wildcard $(dir $1)),,$(shell mkdir "$(dir $1)"))
-	@$3 $4 $(CLANGFLAGS) -o $1 $2
+	@$(if $(wildcard $(dir $1)),,mkdir $(if $(ISWIN),"$(subst /,\,$(dir $1))",-p "$(dir $1)"))
+	@$3 $4 $(SYS_CLANGFLAGS) $(if $(filter $(SYS_NOLTO),$2),,$(LTOFLAGS)) -dependency-file $(patsubst %.o,%.d,$1) -MT $1 -MP -o $1 $2
 endef
 
-$(WAJIC_ROOT)system/system.bc : $(SYS_CPP_OBJS) $(SYS_CC_OBJS)
+# Each archive depends on the objects in its component subdirectory and gets recreated from all of them when any object changes
+$(foreach L,c c++ c++abi compiler_rt malloc,$(eval $(SYS_LIBDIR)/lib$(L).a : $(filter $(SYS_OBJDIR)/$(L)/%,$(SYS_CPP_OBJS) $(SYS_CC_OBJS))))
+$(SYS_LIBDIR)/lib%.a :
 	$(info Creating archive $@ ...)
-	@$(LD) $(if $(ISWIN),"temp/*.o",temp/*.o) -r -o $@
-	@$(if $(ISWIN),rmdir /S /Q,rm -rf) "temp"
-endif #need system.bc
+	@$(if $(wildcard $@),$(if $(ISWIN),del "$(subst /,\,$@)",rm -f "$@") $(PIPETONULL))
+	@$(AR) rcs $@ $(if $(ISWIN),"$(SYS_OBJDIR)/$*/*.o",$(SYS_OBJDIR)/$*/*.o)
+endif #system sources
+endif #not a side module
 #------------------------------------------------------------------------------------------------------
@@ -0,0 +1,208 @@
+/*
+  WAjic - WebAssembly JavaScript Interface Creator
+  Copyright (C) 2020 Bernhard Schelling
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+// Size class slab allocator for builds with ALLOCATOR=slab in wajic.mk (or -allocator slab in wajicup.js)
+// Allocations up to 2048 bytes are served from 64 kb slabs that each hold blocks of a single size class. Allocating and
+// freeing is a free list push/pop without any searching or block splitting/merging, and because blocks of the same size
+// share a slab, long running programs don't fragment the heap with small allocations in between large ones.
+// Slabs are allocated from emmalloc (which also handles all larger allocations) and get returned when they become empty.
+// Because WAjic programs are single threaded there is no thread cache, the size class free lists are used directly.
+
+#pragma once
+
+#ifdef WA_ALLOC_IMPLEMENTATION
+
+#include <wajic.h>
+#include <stddef.h>
+#include <string.h>
+
+// The original allocator functions of emmalloc in the system library
+WA_EXTERN void* emmalloc_malloc(size_t size);
+WA_EXTERN void* emmalloc_memalign(size_t alignment, size_t size);
+WA_EXTERN void* emmalloc_realloc(void* ptr, size_t size);
+WA_EXTERN void emmalloc_free(void* ptr);
+WA_EXTERN size_t emmalloc_usable_size(void* ptr);
+
+enum
+{
+	WA_ALLOC_SLAB_SIZE = 65536,  // Size and alignment of a slab
+	WA_ALLOC_SLAB_HEADER = 64,   // Space at the start of a slab used by WaAlloc_Slab
+	WA_ALLOC_MAX_SMALL = 2048,   // Largest size served from slabs
+	WA_ALLOC_CLASSES = 24,       // Number of size classes
+};
+
+typedef struct WaAlloc_Slab
+{
+	struct WaAlloc_Slab *next, *prev; // Links in the list of slabs of the size class that have free blocks
+	void* free_list;                  // Blocks that have been freed
+	char* bump;                       // Next block that has never been used
+	unsigned int size_class, block_size, used, capacity;
+} WaAlloc_Slab;
+
+static struct
+{
+	WaAlloc_Slab* partial[WA_ALLOC_CLASSES];      // Slabs with free blocks by size class
+	unsigned char slab_pages[65536 / 8];          // Bit set for every 64 kb page of linear memory that is a slab
+} WaAlloc;
+
+// Size classes are multiples of 16 up to 128 bytes, then 4 steps per power of two up to 2048 bytes
+static const unsigned short WaAlloc_ClassSizes[WA_ALLOC_CLASSES] = { 16, 32, 48, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384, 448, 512, 640, 768, 896, 1024, 1280, 1536, 1792, 2048 };
+
+static unsigned int WaAlloc_Class(size_t size)
+{
+	unsigned int log2;
+	if (size <= 128) return (size ? (unsigned int)(size - 1) >> 4 : 0);
+	log2 = 31 - __builtin_clz((unsigned int)size - 1); // 7 for 129..256, 8 for 257..512, etc.
+	return 8 + (log2 - 7) * 4 + ((unsigned int)(size - 1) >> (log2 - 2) & 3);
+}
+
+static int WaAlloc_IsSlab(void* ptr)
+{
+	size_t page = (size_t)ptr / WA_ALLOC_SLAB_SIZE;
+	return (WaAlloc.slab_pages[page >> 3] >> (page & 7)) & 1;
+}
+
+static void WaAlloc_Link(WaAlloc_Slab* s)
+{
+	s->prev = 0;
+	s->next = WaAlloc.partial[s->size_class];
+	if (s->next) s->next->prev = s;
+	WaAlloc.partial[s->size_class] = s;
+}
+
+static void WaAlloc_Unlink(WaAlloc_Slab* s)
+{
+	if (s->prev) s->prev->next = s->next;
+	else WaAlloc.partial[s->size_class] = s->next;
+	if (s->next) s->next->prev = s->prev;
+}
+
+static void* WaAlloc_Small(unsigned int cls)
+{
+	WaAlloc_Slab* s = WaAlloc.partial[cls];
+	void* ptr;
+	if (!s)
+	{
+		size_t page;
+		if (!(s = (WaAlloc_Slab*)emmalloc_memalign(WA_ALLOC_SLAB_SIZE, WA_ALLOC_SLAB_SIZE))) return 0;
+		page = (size_t)s / WA_ALLOC_SLAB_SIZE;
+		WaAlloc.slab_pages[page >> 3] |= (unsigned char)(1 << (page & 7));
+		s->free_list = 0;
+		s->bump = (char*)s + WA_ALLOC_SLAB_HEADER;
+		s->size_class = cls;
+		s->block_size = WaAlloc_ClassSizes[cls];
+		s->used = 0;
+		s->capacity = (WA_ALLOC_SLAB_SIZE - WA_ALLOC_SLAB_HEADER) / s->block_size;
+		WaAlloc_Link(s);
+	}
+	if (s->free_list) { ptr = s->free_list; s->free_list = *(void**)ptr; }
+	else { ptr = s->bump; s->bump += s->block_size; }
+	if (++s->used == s->capacity) WaAlloc_Unlink(s);
+	return ptr;
+}
+
+static void WaAlloc_FreeSmall(void* ptr)
+{
+	WaAlloc_Slab* s = (WaAlloc_Slab*)((size_t)ptr & ~(size_t)(WA_ALLOC_SLAB_SIZE - 1));
+	if (s->used-- == s->capacity) WaAlloc_Link(s);
+	if (!s->used && (s->prev || s->next))
+	{
+		// Return an empty slab unless it is the only one of its size class (avoids repeated slab allocation on churn)
+		size_t page = (size_t)s / WA_ALLOC_SLAB_SIZE;
+		WaAlloc_Unlink(s);
+		WaAlloc.slab_pages[page >> 3] &= (unsigned char)~(1 << (page & 7));
+		emmalloc_free(s);
+		return;
+	}
+	*(void**)ptr = s->free_list;
+	s->free_list = ptr;
+}
+
+WA_EXTERN void* WaAllocMalloc(size_t size)
+{
+	return (size <= WA_ALLOC_MAX_SMALL ? WaAlloc_Small(WaAlloc_Class(size)) : emmalloc_malloc(size));
+}
+
+WA_EXTERN void* WaAllocMemalign(size_t alignment, size_t size)
+{
+	// Slab blocks are 16 byte aligned but larger allocations from emmalloc_malloc are only guaranteed to be 8 byte aligned
+	return (alignment <= 8 || (alignment <= 16 && size <= WA_ALLOC_MAX_SMALL) ? WaAllocMalloc(size) : emmalloc_memalign(alignment, size));
+}
+
+WA_EXTERN void WaAllocFree(void* ptr)
+{
+	if (!ptr) return;
+	if (WaAlloc_IsSlab(ptr)) WaAlloc_FreeSmall(ptr);
+	else emmalloc_free(ptr);
+}
+
+WA_EXTERN size_t WaAllocUsableSize(void* ptr)
+{
+	if (!ptr) return 0;
+	if (WaAlloc_IsSlab(ptr)) return ((WaAlloc_Slab*)((size_t)ptr & ~(size_t)(WA_ALLOC_SLAB_SIZE - 1)))->block_size;
+	return emmalloc_usable_size(ptr);
+}
+
+WA_EXTERN void* WaAllocRealloc(void* ptr, size_t size)
+{
+	size_t old_size;
+	void* res;
+	if (!ptr) return WaAllocMalloc(size);
+	if (!size) { WaAllocFree(ptr); return 0; }
+	old_size = WaAllocUsableSize(ptr);
+	if (WaAlloc_IsSlab(ptr))
+	{
+		// Keep the block if the new size still falls in the same size class
+		if (size <= WA_ALLOC_MAX_SMALL && WaAlloc_ClassSizes[WaAlloc_Class(size)] == old_size) return ptr;
+	}
+	else if (size > WA_ALLOC_MAX_SMALL) return emmalloc_realloc(ptr, size);
+	if (!(res = WaAllocMalloc(size))) return 0;
+	memcpy(res, ptr, (size < old_size ? size : old_size));
+	WaAllocFree(ptr);
+	return res;
+}
+
+#ifndef WA_MEMPROF
+// Replace the allocation functions of the system library (unless wajic_memprof.h wraps the functions above)
+WA_EXTERN void* malloc(size_t size) { return WaAllocMalloc(size); }
+WA_EXTERN void* memalign(size_t alignment, size_t size) { return WaAllocMemalign(alignment, size); }
+WA_EXTERN void* aligned_alloc(size_t alignment, size_t size) { return WaAllocMemalign(alignment, size); }
+WA_EXTERN void* realloc(void* ptr, size_t size) { return WaAllocRealloc(ptr, size); }
+WA_EXTERN void free(void* ptr) { WaAllocFree(ptr); }
+WA_EXTERN size_t malloc_usable_size(void* ptr) { return WaAllocUsableSize(ptr); }
+
+WA_EXTERN int posix_memalign(void** res, size_t alignment, size_t size)
+{
+	void* ptr = WaAllocMemalign(alignment, size);
+	if (!ptr) return 12; //ENOMEM
+	*res = ptr;
+	return 0;
+}
+
+WA_EXTERN void* calloc(size_t num, size_t size)
+{
+	void* ptr = (size && num > (size_t)-1 / size ? 0 : WaAllocMalloc(num * size));
+	if (ptr) memset(ptr, 0, num * size);
+	return ptr;
+}
+#endif
+
+#endif //WA_ALLOC_IMPLEMENTATION
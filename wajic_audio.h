@@ -0,0 +1,236 @@
+/*
+  WAjic - WebAssembly JavaScript Interface Creator
+  Copyright (C) 2020 Bernhard Schelling
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include <wajic.h>
+
+// Statistics about the running audio output (filled by WaAudioGetStats)
+typedef struct WaAudioStats
+{
+	unsigned int sample_rate;     // Actual sample rate of the audio output
+	unsigned int channels;        // Number of channels rendered per sample frame
+	unsigned int latency_frames;  // Target latency (number of sample frames kept queued)
+	unsigned int buffered_frames; // Number of sample frames currently queued for playback
+	unsigned int underruns;       // Number of times the audio thread ran out of queued sample frames
+	unsigned int overruns;        // Number of sample frames dropped because the ring buffer was full
+	unsigned int shared_memory;   // 1 if the ring buffer is read directly from shared wasm memory, 0 if blocks are posted to the audio thread
+} WaAudioStats;
+
+// Start audio output which calls a render function that has been marked with WA_EXPORT whenever more audio data is needed
+// The render function has the signature 'int Render(float* sample_buffer, unsigned int frames)' and fills a block of
+// non-interleaved samples (all frames of the first channel followed by all frames of the second channel and so on).
+// If it returns 0, the block is played back as silence.
+// Playback runs through an AudioWorklet which reads from a single-producer/single-consumer ring buffer that is kept
+// filled up to latency_ms. If the wasm memory is shared the ring buffer lives in it, otherwise blocks get posted over.
+// Returns 0 if audio output is not available.
+WAJIC_LIB_WITH_INIT(AUDIO,
+(
+	var AUctx, AUnode, AUrender, AUtmp, AUhdr, AUchannels, AUlatency, AUcap, AUblock = 256, AUsent = 0, AUstatus = [0,0,0,0];
+
+	// The AudioWorkletProcessor code which gets loaded into the audio thread by converting this function into a string
+	// Ring buffer header is [read frame count, written frame count, underruns, overruns] followed by one ring per channel
+	var AUworklet = () => registerProcessor('wajic-audio', class extends AudioWorkletProcessor
+	{
+		constructor(o)
+		{
+			super();
+			o = o.processorOptions;
+			var c = this.c = o.c, n = this.n = o.n, i;
+			this.h = (o.m ? new Int32Array(o.m, o.h, 4) : new Int32Array(4));
+			for (this.r = [], i = 0; i != c; i++) this.r[i] = (o.m ? new Float32Array(o.m, o.h + 16 + i*n*4, n) : new Float32Array(n));
+			this.t = 0;
+			this.port.onmessage = e =>
+			{
+				// Without shared memory, blocks of samples are posted over and written into the ring buffer here
+				var d = e.data, h = this.h, w = h[1], f = d.length/c, blk = f, free = n - (w - h[0]), i, j;
+				if (f > free) { h[3] += f - free; f = free; }
+				for (i = 0; i != c; i++)
+					for (j = 0; j != f; j++)
+						this.r[i][(w+j)&(n-1)] = d[i*blk+j];
+				h[1] = w + f;
+			};
+		}
+		process(inputs, outputs)
+		{
+			var out = outputs[0], len = out[0].length, h = this.h, n = this.n, r = Atomics.load(h, 0), w = Atomics.load(h, 1), f = Math.min(w - r, len), i, j, o, ring;
+			for (i = 0; i != out.length; i++)
+			{
+				for (o = out[i], ring = this.r[i % this.c], j = 0; j != f; j++) o[j] = ring[(r+j)&(n-1)];
+				o.fill(0, f);
+			}
+			if (f < len && w) Atomics.add(h, 2, 1);
+			Atomics.store(h, 0, r + f);
+
+			// Report the state back to the main thread every few blocks which triggers rendering more audio
+			if ((this.t += len) >= 512) { this.t = 0; this.port.postMessage([h[1], h[1] - h[0], h[2], h[3]]); }
+			return true;
+		}
+	});
+
+	// Number of sample frames written into the ring buffer (or in flight to it) that have not been played yet
+	var AUbuffered = function()
+	{
+		if (AUhdr) return Atomics.load(MI32, (AUhdr>>2)+1) - Atomics.load(MI32, AUhdr>>2);
+		return AUsent - AUstatus[0] + AUstatus[1];
+	};
+
+	// Calls the render function until the ring buffer is filled up to the target latency
+	var AUfill = function()
+	{
+		if (!AUnode) return;
+		if (STOP) { AUctx.close(); AUctx = AUnode = null; return; }
+		for (var t = AUtmp>>2, n = AUblock*AUchannels, w, c, i, j, blk; AUbuffered() + AUblock <= AUlatency; AUsent += AUblock)
+		{
+			if (!AUrender(AUtmp, AUblock)) MF32.fill(0, t, t + n);
+			if (AUhdr)
+			{
+				// Write directly into the ring buffer in shared memory which is read by the audio thread
+				for (w = MI32[(AUhdr>>2)+1], c = 0; c != AUchannels; c++)
+					for (j = (AUhdr>>2) + 4 + c*AUcap, i = 0; i != AUblock; i++)
+						MF32[j + ((w+i)&(AUcap-1))] = MF32[t + c*AUblock + i];
+				Atomics.store(MI32, (AUhdr>>2)+1, w + AUblock);
+			}
+			else
+			{
+				// Transfer a copy of the rendered block to the audio thread
+				blk = MF32.slice(t, t + n);
+				AUnode.port.postMessage(blk, [blk.buffer]);
+			}
+		}
+	};
+
+	var AUsetLatency = function(latency_ms)
+	{
+		AUlatency = Math.max(AUblock, Math.min(AUcap - AUblock, Math.ceil(AUctx.sampleRate * latency_ms / 1000)));
+	};
+),
+int, WaAudioStart, (const char* exported_renderfunc, unsigned int channels WA_ARG(2), unsigned int sample_rate WA_ARG(44100), unsigned int latency_ms WA_ARG(50)),
+{
+	if (AUctx) return 1;
+	try { AUctx = new AudioContext({sampleRate: sample_rate}); } catch (e) { }
+	if (!AUctx || !AUctx.audioWorklet) { AUctx = null; WA.print('Warning: WebAudio AudioWorklet not supported\n'); return 0; }
+	AUrender = ASM[MStrGet(exported_renderfunc)];
+	if (!AUrender) throw 'bad callback';
+
+	// The ring buffer capacity is a power of two which can hold at least twice the requested latency
+	AUchannels = channels;
+	for (AUcap = AUblock*2; AUcap < AUctx.sampleRate * latency_ms / 500 + AUblock; AUcap *= 2);
+	AUsetLatency(latency_ms);
+	AUtmp = ASM.malloc(AUblock*channels*4);
+	AUsent = 0;
+	AUstatus = [0,0,0,0];
+
+	var opts = { c: channels, n: AUcap }, mem = MU8.buffer;
+	if (typeof SharedArrayBuffer != 'undefined' && mem instanceof SharedArrayBuffer)
+	{
+		// With shared memory the audio thread reads from the ring buffer on the wasm heap directly
+		AUhdr = ASM.malloc(16 + AUcap*channels*4);
+		MU8.fill(0, AUhdr, AUhdr + 16);
+		opts.m = mem;
+		opts.h = AUhdr;
+	}
+
+	AUctx.audioWorklet.addModule(URL.createObjectURL(new Blob(['(' + AUworklet + ')()'], {type: 'text/javascript'}))).then(() =>
+	{
+		if (!AUctx) return;
+		AUnode = new AudioWorkletNode(AUctx, 'wajic-audio', { numberOfInputs: 0, outputChannelCount: [channels], processorOptions: opts });
+		AUnode.port.onmessage = e => { AUstatus = e.data; AUfill(); };
+		AUnode.connect(AUctx.destination);
+		AUfill();
+	}).catch(e => WA.print('Warning: AudioWorklet failed to load (' + e + ')\n'));
+
+	// Try to start the audio playback when the browser requires user interaction to do so
+	var resume = () => { if (AUctx && AUctx.state == 'suspended') AUctx.resume(); };
+	['click', 'keydown', 'touchend'].forEach(t => window.addEventListener(t, resume, true));
+	return 1;
+})
+
+// Change the target latency of the running audio output (limited to twice the latency passed to WaAudioStart)
+WAJIC_LIB(AUDIO, void, WaAudioSetLatency, (unsigned int latency_ms),
+{
+	if (AUctx) AUsetLatency(latency_ms);
+})
+
+// Stop the audio output and free the ring buffer
+WAJIC_LIB(AUDIO, void, WaAudioStop, (),
+{
+	if (!AUctx) return;
+	AUctx.close();
+	ASM.free(AUtmp);
+	if (AUhdr) ASM.free(AUhdr);
+	AUctx = AUnode = AUtmp = AUhdr = null;
+})
+
+// Get the current state and underrun/overrun counters of the audio output
+WAJIC_LIB(AUDIO, void, WaAudioGetStats, (WaAudioStats* stats),
+{
+	var h = AUhdr>>2;
+	stats >>= 2;
+	MU32[stats  ] = (AUctx ? AUctx.sampleRate : 0);
+	MU32[stats+1] = (AUctx ? AUchannels : 0);
+	MU32[stats+2] = (AUctx ? AUlatency : 0);
+	MU32[stats+3] = (AUctx ? AUbuffered() : 0);
+	MU32[stats+4] = (AUhdr ? MI32[h+2] : AUstatus[2]);
+	MU32[stats+5] = (AUhdr ? MI32[h+3] : AUstatus[3]);
+	MU32[stats+6] = !!AUhdr;
+})
+
+// Render audio offline by calling the render function (see WaAudioStart) as fast as possible without any audio output
+// This is meant for measuring the throughput of audio code (i.e. under Node.js) and prints the achieved samples per second.
+// Rendering is done in blocks of block_frames until the requested number of frames has been generated.
+// If wav_path is set, the output is written as a 32-bit float WAV file (only supported when running under Node.js).
+// Returns the realtime factor (seconds of audio rendered per second of processing time).
+WAJIC_LIB(AUDIO, double, WaAudioRenderOffline, (const char* exported_renderfunc, unsigned int frames, unsigned int channels WA_ARG(2), unsigned int sample_rate WA_ARG(44100), unsigned int block_frames WA_ARG(256), const char* wav_path WA_ARG(0)),
+{
+	var render = ASM[MStrGet(exported_renderfunc)], clock = (typeof performance != 'undefined' ? performance : Date), path = MStrGet(wav_path);
+	if (!render) throw 'bad callback';
+	var tmp = ASM.malloc(block_frames*channels*4), t = tmp>>2, wav = (path && new Float32Array(frames*channels)), total = 0, done, blk, c, i, j, start;
+	for (done = 0; done < frames; done += blk)
+	{
+		// Only the calls of the render function are measured, copying into the wav buffer is not
+		blk = Math.min(block_frames, frames - done);
+		start = clock.now();
+		if (!render(tmp, blk)) MF32.fill(0, t, t + blk*channels);
+		total += clock.now() - start;
+		if (wav)
+			for (c = 0; c != channels; c++)
+				for (j = done*channels + c, i = 0; i != blk; i++, j += channels)
+					wav[j] = MF32[t + c*blk + i];
+	}
+	ASM.free(tmp);
+
+	var secs = total / 1000, rtf = (secs ? frames / sample_rate / secs : 0);
+	WA.print('Rendered ' + frames + ' frames (' + channels + ' channels, block size ' + block_frames + ') in ' + total.toFixed(2) + ' ms - ' + (secs ? (frames * channels / secs / 1e6).toFixed(2) : '-') + ' M samples/s - ' + rtf.toFixed(1) + 'x realtime\n');
+
+	if (wav)
+	{
+		// Write the RIFF WAVE header with format 3 (IEEE float) followed by the interleaved samples
+		var hdr = new DataView(new ArrayBuffer(44)), str = (o, s) => { for (i = 0; i != 4; i++) hdr.setUint8(o+i, s.charCodeAt(i)); };
+		str(0, 'RIFF'); hdr.setUint32(4, 36 + wav.byteLength, 1); str(8, 'WAVE');
+		str(12, 'fmt '); hdr.setUint32(16, 16, 1); hdr.setUint16(20, 3, 1); hdr.setUint16(22, channels, 1);
+		hdr.setUint32(24, sample_rate, 1); hdr.setUint32(28, sample_rate*channels*4, 1); hdr.setUint16(32, channels*4, 1); hdr.setUint16(34, 32, 1);
+		str(36, 'data'); hdr.setUint32(40, wav.byteLength, 1);
+		if ((typeof process)[0]=='o') require('fs').writeFileSync(path, Buffer.concat([new Uint8Array(hdr.buffer), new Uint8Array(wav.buffer)]));
+		else WA.print('Warning: Writing WAV file ' + path + ' is only supported with Node.js\n');
+	}
+	return rtf;
+})
@@ -62,9 +62,7 @@ WAJIC_LIB(FILE, void, WaFileLoadUrl, (const char* exported_callback, const char*
 	{
 		if (xhr.status == 200)
 		{
-			var ptr = MArrPut(new Uint8Array(xhr.response));
-			cb(200, ptr, xhr.response.byteLength, userdata);
-			ASM.free(ptr);
+			cb(200, MArrPutTemp(new Uint8Array(xhr.response)), xhr.response.byteLength, userdata);
 		}
 		else cb(xhr.status, 0, 0, userdata);
 	};
@@ -47,43 +47,41 @@
 #include <GL/gl.h>
 #include <wajic.h>
 
+// The init code is split into named fragments ("#Name"; markers) of which wajicup.js only keeps the ones used by the imported functions
 WAJIC_LIB_WITH_INIT(GL,
 (
-	const GLMINI_TEMP_BUFFER_SIZE = 256, kUniforms = 'u', kMaxUniformLength = 'm', kMaxAttributeLength = 'a', kMaxUniformBlockNameLength = 'b';
+	const kUniforms = 'u', kMaxUniformLength = 'm', kMaxAttributeLength = 'a', kMaxUniformBlockNameLength = 'b';
 	var GLctx;
+	"#GLbuffers";       var GLbuffers = [];
+	"#GLprograms";      var GLprograms = [];
+	"#GLframebuffers";  var GLframebuffers = [];
+	"#GLtextures";      var GLtextures = [];
+	"#GLrenderbuffers"; var GLrenderbuffers = [];
+	"#GLuniforms";      var GLuniforms = [];
+	"#GLshaders";       var GLshaders = [];
+	"#GLvaos";          var GLvaos = [];
+	"#GLprogramInfos";  var GLprogramInfos = {};
+	"#GLstringCache";   var GLstringCache = {};
+	"#GLpackAlignment"; var GLpackAlignment = 4;
+	"#GLunpackAlignment"; var GLunpackAlignment = 4;
+	"#GLFixedLengthArrays"; var GLFixedLengthArrays = [];
+
+	"#GLgetNewId";
 	var GLcounter = 1;
-	var GLbuffers = [];
-	var GLprograms = [];
-	var GLframebuffers = [];
-	var GLtextures = [];
-	var GLrenderbuffers = [];
-	var GLuniforms = [];
-	var GLshaders = [];
-	var GLvaos = [];
-	var GLprogramInfos = {};
-	var GLstringCache = {};
-	var GLpackAlignment = 4;
-	var GLunpackAlignment = 4;
-	var GLFixedLengthArrays = [];
-	var GLminiTempFloatBuffers = [];
-	var GLminiTempIntBuffers = [];
-	for (let i = 0, fbuf = new Float32Array(GLMINI_TEMP_BUFFER_SIZE), ibuf = new Int32Array(GLMINI_TEMP_BUFFER_SIZE); i < GLMINI_TEMP_BUFFER_SIZE; i++)
-	{
-		GLminiTempFloatBuffers[i] = fbuf.subarray(0, i+1);
-		GLminiTempIntBuffers[i] = ibuf.subarray(0, i+1);
-	}
-
 	function GLgetNewId(table)
 	{
 		for (var ret = GLcounter++, i = table.length; i < ret; i++) table[i] = null;
 		return ret;
 	}
 
+	"#GLrecordError,GLlastError";
+	var GLlastError = 0;
 	function GLrecordError(err)
 	{
 		if (!GLlastError) GLlastError = err;
 	}
 
+	"#GLgetTexPixelData";
 	function GLgetTexPixelData(type, format, width, height, pixels, internalFormat)
 	{
 		var sizePerPixel;
@@ -121,6 +119,7 @@ WAJIC_LIB_WITH_INIT(GL,
 		}
 	}
 
+	"#GLget";
 	function GLget(name, p, type)
 	{
 		// Guard against user passing a null pointer.
@@ -216,6 +215,7 @@ WAJIC_LIB_WITH_INIT(GL,
 		}
 	}
 
+	"#GLwriteNumOrArr";
 	function GLwriteNumOrArr(data, params, type)
 	{
 		if (typeof data == 'number' || typeof data == 'boolean')
@@ -225,11 +225,13 @@ WAJIC_LIB_WITH_INIT(GL,
 				(type ? MF32 : MI32)[(params>>2)+i] = data[i];
 	}
 
+	"#GLgetUniform";
 	function GLgetUniform(program, location, params, type)
 	{
 		GLwriteNumOrArr(GLctx.getUniform(GLprograms[program], GLuniforms[location]), params, type);
 	}
 
+	"#GLgetVertexAttrib";
 	function GLgetVertexAttrib(index, pname, params, type)
 	{
 		var data = GLctx.getVertexAttrib(index, pname);
@@ -239,6 +241,7 @@ WAJIC_LIB_WITH_INIT(GL,
 			GLwriteNumOrArr(data, params, type)
 	}
 
+	"#GLgenObjects";
 	function GLgenObjects(n, buffers, createFunction, objectTable)
 	{
 		for (var i = 0; i < n; i++)
@@ -333,15 +336,15 @@ WAJIC_LIB(GL, void, glBlendEquationSeparate, (GLenum modeRGB, GLenum modeAlpha),
 	GLctx.blendEquationSeparate(modeRGB, modeAlpha);
 })
 
-WAJIC_LIB(GL, void, glBufferData, (GLenum target, GLsizeiptr size, const void *data, GLenum usage),
+WAJIC_LIB(GL, void, glBufferData, (GLenum target, GLsizeiptr size, const void *WA_U8ARRAY(data, size), GLenum usage),
 {
 	if (!data) GLctx.bufferData(target, size, usage);
-	else GLctx.bufferData(target, MU8.subarray(data, data+size), usage);
+	else GLctx.bufferData(target, data, usage);
 })
 
-WAJIC_LIB(GL, void, glBufferSubData, (GLenum target, GLintptr offset, GLsizeiptr size, const void *data),
+WAJIC_LIB(GL, void, glBufferSubData, (GLenum target, GLintptr offset, GLsizeiptr size, const void *WA_U8ARRAY(data, size)),
 {
-	GLctx.bufferSubData(target, offset, MU8.subarray(data, data+size));
+	GLctx.bufferSubData(target, offset, data);
 })
 
 WAJIC_LIB(GL, void, glClear, (GLbitfield mask),
@@ -380,11 +383,11 @@ WAJIC_LIB(GL, GLuint, glCreateShader, (GLenum type),
 	return id;
 })
 
-WAJIC_LIB(GL, void, glDeleteBuffers, (GLsizei n, const GLuint *buffers),
+WAJIC_LIB(GL, void, glDeleteBuffers, (GLsizei n, const GLuint *WA_INDEX32(buffers)),
 {
 	for (var i = 0; i < n; i++)
 	{
-		var id = MI32[(buffers>>2)+i];
+		var id = MI32[buffers+i];
 		var buffer = GLbuffers[id];
 		if (!buffer) continue; //GL spec: "glDeleteBuffers silently ignores 0's and names that do not correspond to existing buffer objects".
 		GLctx.deleteBuffer(buffer);
@@ -881,249 +884,59 @@ WAJIC_LIB(GL, void, glUniform4i, (GLint location, GLint v0, GLint v1, GLint v2,
 	GLctx.glUniform4i(GLuniforms[location], v0, v1, v2, v3);
 })
 
-WAJIC_LIB(GL, void, glUniform1fv, (GLint location, GLsizei count, const GLfloat *value),
+WAJIC_LIB(GL, void, glUniform1fv, (GLint location, GLsizei count, const GLfloat *WA_F32ARRAY(value, count)),
 {
-	value >>= 2;
-	var view, heap = MF32;
-	if (count <= GLMINI_TEMP_BUFFER_SIZE)
-	{
-		// avoid allocation when uploading few enough uniforms
-		view = GLminiTempFloatBuffers[count-1];
-		for (var i = 0; i != count; i++)
-			view[i] = heap[value+i];
-	}
-	else
-	{
-		view = heap.subarray(value, value + count);
-	}
-	GLctx.uniform1fv(GLuniforms[location], view);
+	GLctx.uniform1fv(GLuniforms[location], value);
 })
 
-WAJIC_LIB(GL, void, glUniform1iv, (GLint location, GLsizei count, const GLint *value),
+WAJIC_LIB(GL, void, glUniform1iv, (GLint location, GLsizei count, const GLint *WA_I32ARRAY(value, count)),
 {
-	value >>= 2;
-	var view, heap = MI32;
-	if (count <= GLMINI_TEMP_BUFFER_SIZE)
-	{
-		// avoid allocation when uploading few enough uniforms
-		var view = GLminiTempIntBuffers[count-1];
-		for (var i = 0; i != count; i++)
-			view[i] = heap[value+i];
-	}
-	else
-	{
-		view = heap.subarray(value, value + count);
-	}
-	GLctx.uniform1fv(GLuniforms[location], view);
+	GLctx.uniform1iv(GLuniforms[location], value);
 })
 
-WAJIC_LIB(GL, void, glUniform2fv, (GLint location, GLsizei count, const GLfloat *value),
+WAJIC_LIB(GL, void, glUniform2fv, (GLint location, GLsizei count, const GLfloat *WA_F32ARRAY(value, count*2)),
 {
-	count *= 2;
-	value >>= 2;
-	var view, heap = MF32;
-	if (count <= GLMINI_TEMP_BUFFER_SIZE)
-	{
-		// avoid allocation when uploading few enough uniforms
-		view = GLminiTempFloatBuffers[count-1];
-		for (var i = 0; i != count; i += 2)
-		{
-			view[i  ] = heap[value+i  ];
-			view[i+1] = heap[value+i+1];
-		}
-	}
-	else
-	{
-		view = heap.subarray(value, value + count);
-	}
-	GLctx.uniform2fv(GLuniforms[location], view);
+	GLctx.uniform2fv(GLuniforms[location], value);
 })
 
-WAJIC_LIB(GL, void, glUniform2iv, (GLint location, GLsizei count, const GLint *value),
+WAJIC_LIB(GL, void, glUniform2iv, (GLint location, GLsizei count, const GLint *WA_I32ARRAY(value, count*2)),
 {
-	count *= 2;
-	value >>= 2;
-	var view, heap = MI32;
-	if (count <= GLMINI_TEMP_BUFFER_SIZE)
-	{
-		// avoid allocation when uploading few enough uniforms
-		view = GLminiTempIntBuffers[count-1];
-		for (var i = 0; i != count; i += 2)
-		{
-			view[i  ] = heap[value+i  ];
-			view[i+1] = heap[value+i+1];
-		}
-	}
-	else
-	{
-		view = heap.subarray(value, value + count);
-	}
-	GLctx.uniform2iv(GLuniforms[location], view);
+	GLctx.uniform2iv(GLuniforms[location], value);
 })
 
-WAJIC_LIB(GL, void, glUniform3fv, (GLint location, GLsizei count, const GLfloat *value),
+WAJIC_LIB(GL, void, glUniform3fv, (GLint location, GLsizei count, const GLfloat *WA_F32ARRAY(value, count*3)),
 {
-	count *= 3;
-	value >>= 2;
-	var view, heap = MF32;
-	if (count <= GLMINI_TEMP_BUFFER_SIZE)
-	{
-		// avoid allocation when uploading few enough uniforms
-		view = GLminiTempFloatBuffers[count-1];
-		for (var i = 0; i != count; i += 3)
-		{
-			view[i  ] = heap[value+i  ];
-			view[i+1] = heap[value+i+1];
-			view[i+2] = heap[value+i+2];
-		}
-	}
-	else
-	{
-		view = heap.subarray(value, value + count);
-	}
-	GLctx.uniform3fv(GLuniforms[location], view);
+	GLctx.uniform3fv(GLuniforms[location], value);
 })
 
-WAJIC_LIB(GL, void, glUniform3iv, (GLint location, GLsizei count, const GLint *value),
+WAJIC_LIB(GL, void, glUniform3iv, (GLint location, GLsizei count, const GLint *WA_I32ARRAY(value, count*3)),
 {
-	count *= 3;
-	value >>= 2;
-	var view, heap = MI32;
-	if (count <= GLMINI_TEMP_BUFFER_SIZE)
-	{
-		// avoid allocation when uploading few enough uniforms
-		view = GLminiTempIntBuffers[count-1];
-		for (var i = 0; i != count; i += 3)
-		{
-			view[i  ] = heap[value+i  ];
-			view[i+1] = heap[value+i+1];
-			view[i+2] = heap[value+i+2];
-		}
-	}
-	else
-	{
-		view = heap.subarray(value, value + count);
-	}
-	GLctx.uniform3iv(GLuniforms[location], view);
+	GLctx.uniform3iv(GLuniforms[location], value);
 })
 
-WAJIC_LIB(GL, void, glUniform4fv, (GLint location, GLsizei count, const GLfloat *value),
+WAJIC_LIB(GL, void, glUniform4fv, (GLint location, GLsizei count, const GLfloat *WA_F32ARRAY(value, count*4)),
 {
-	count *= 4;
-	value >>= 2;
-	var view, heap = MF32;
-	if (count <= GLMINI_TEMP_BUFFER_SIZE)
-	{
-		// avoid allocation when uploading few enough uniforms
-		view = GLminiTempFloatBuffers[count-1];
-		for (var i = 0; i != count; i += 4)
-		{
-			view[i  ] = heap[value+i  ];
-			view[i+1] = heap[value+i+1];
-			view[i+2] = heap[value+i+2];
-			view[i+3] = heap[value+i+3];
-		}
-	}
-	else
-	{
-		view = heap.subarray(value, value + count);
-	}
-	GLctx.uniform4fv(GLuniforms[location], view);
+	GLctx.uniform4fv(GLuniforms[location], value);
 })
 
-WAJIC_LIB(GL, void, glUniform4iv, (GLint location, GLsizei count, const GLint *value),
+WAJIC_LIB(GL, void, glUniform4iv, (GLint location, GLsizei count, const GLint *WA_I32ARRAY(value, count*4)),
 {
-	count *= 4;
-	value >>= 2;
-	var view, heap = MI32;
-	if (count <= GLMINI_TEMP_BUFFER_SIZE)
-	{
-		// avoid allocation when uploading few enough uniforms
-		view = GLminiTempIntBuffers[count-1];
-		for (var i = 0; i != count; i += 4)
-		{
-			view[i  ] = heap[value+i  ];
-			view[i+1] = heap[value+i+1];
-			view[i+2] = heap[value+i+2];
-			view[i+3] = heap[value+i+3];
-		}
-	}
-	else
-	{
-		view = heap.subarray(value, value + count);
-	}
-	GLctx.uniform4fv(GLuniforms[location], view);
+	GLctx.uniform4iv(GLuniforms[location], value);
 })
 
-WAJIC_LIB(GL, void, glUniformMatrix2fv, (GLint location, GLsizei count, GLboolean transpose, const GLfloat *value),
+WAJIC_LIB(GL, void, glUniformMatrix2fv, (GLint location, GLsizei count, GLboolean transpose, const GLfloat *WA_F32ARRAY(value, count*4)),
 {
-	count <<= 2;
-	value >>= 2;
-	var view, heap = MF32;
-	if (count <= GLMINI_TEMP_BUFFER_SIZE)
-	{
-		// avoid allocation when uploading few enough uniforms
-		view = GLminiTempFloatBuffers[count-1];
-		for (var i = 0; i != count; i += 4)
-		{
-			view[i  ] = heap[value+i  ];
-			view[i+1] = heap[value+i+1];
-			view[i+2] = heap[value+i+2];
-			view[i+3] = heap[value+i+3];
-		}
-	}
-	else
-	{
-		view = heap.subarray(value, value + count);
-	}
-	GLctx.uniformMatrix2fv(GLuniforms[location], !!transpose, view);
+	GLctx.uniformMatrix2fv(GLuniforms[location], !!transpose, value);
 })
 
-WAJIC_LIB(GL, void, glUniformMatrix3fv, (GLint location, GLsizei count, GLboolean transpose, const GLfloat *value),
+WAJIC_LIB(GL, void, glUniformMatrix3fv, (GLint location, GLsizei count, GLboolean transpose, const GLfloat *WA_F32ARRAY(value, count*9)),
 {
-	count *= 9;
-	value >>= 2;
-	var view, heap = MF32;
-	if (count <= GLMINI_TEMP_BUFFER_SIZE)
-	{
-		// avoid allocation when uploading few enough uniforms
-		view = GLminiTempFloatBuffers[count-1];
-		for (var i = 0; i != count; i += 3)
-		{
-			view[i  ] = heap[value+i  ];
-			view[i+1] = heap[value+i+1];
-			view[i+2] = heap[value+i+2];
-		}
-	}
-	else
-	{
-		view = heap.subarray(value, value + count);
-	}
-	GLctx.uniformMatrix3fv(GLuniforms[location], !!transpose, view);
+	GLctx.uniformMatrix3fv(GLuniforms[location], !!transpose, value);
 })
 
-WAJIC_LIB(GL, void, glUniformMatrix4fv, (GLint location, GLsizei count, GLboolean transpose, const GLfloat *value),
+WAJIC_LIB(GL, void, glUniformMatrix4fv, (GLint location, GLsizei count, GLboolean transpose, const GLfloat *WA_F32ARRAY(value, count*16)),
 {
-	count <<= 4;
-	value >>= 2;
-	var view, heap = MF32;
-	if (count <= GLMINI_TEMP_BUFFER_SIZE)
-	{
-		// avoid allocation when uploading few enough uniforms
-		view = GLminiTempFloatBuffers[count-1];
-		for (var i = 0; i != count; i += 4)
-		{
-			view[i  ] = heap[value+i  ];
-			view[i+1] = heap[value+i+1];
-			view[i+2] = heap[value+i+2];
-			view[i+3] = heap[value+i+3];
-		}
-	}
-	else
-	{
-		view = heap.subarray(value, value + count);
-	}
-	GLctx.uniformMatrix4fv(GLuniforms[location], !!transpose, view);
+	GLctx.uniformMatrix4fv(GLuniforms[location], !!transpose, value);
 })
 
 WAJIC_LIB(GL, void, glVertexAttrib1f, (GLuint index, GLfloat x),
@@ -1131,9 +944,9 @@ WAJIC_LIB(GL, void, glVertexAttrib1f, (GLuint index, GLfloat x),
 	GLctx.vertexAttrib1f(index, x);
 })
 
-WAJIC_LIB(GL, void, glVertexAttrib1fv, (GLuint index, const GLfloat *v),
+WAJIC_LIB(GL, void, glVertexAttrib1fv, (GLuint index, const GLfloat *WA_INDEX32(v)),
 {
-	GLctx.vertexAttrib1f(index, MF32[v>>2]);
+	GLctx.vertexAttrib1f(index, MF32[v]);
 })
 
 WAJIC_LIB(GL, void, glVertexAttrib2f, (GLuint index, GLfloat x, GLfloat y),
@@ -1141,9 +954,8 @@ WAJIC_LIB(GL, void, glVertexAttrib2f, (GLuint index, GLfloat x, GLfloat y),
 	GLctx.vertexAttrib2f(index, x, y);
 })
 
-WAJIC_LIB(GL, void, glVertexAttrib2fv, (GLuint index, const GLfloat *v),
+WAJIC_LIB(GL, void, glVertexAttrib2fv, (GLuint index, const GLfloat *WA_INDEX32(v)),
 {
-	v >>= 2;
 	GLctx.vertexAttrib2f(index, MF32[v], MF32[v+1]);
 })
 
@@ -1152,9 +964,8 @@ WAJIC_LIB(GL, void, glVertexAttrib3f, (GLuint index, GLfloat x, GLfloat y, GLflo
 	GLctx.vertexAttrib3f(index, x, y, z);
 })
 
-WAJIC_LIB(GL, void, glVertexAttrib3fv, (GLuint index, const GLfloat *v),
+WAJIC_LIB(GL, void, glVertexAttrib3fv, (GLuint index, const GLfloat *WA_INDEX32(v)),
 {
-	v >>= 2;
 	GLctx.vertexAttrib3f(index, MF32[v], MF32[v+1], MF32[v+2]);
 })
 
@@ -1163,9 +974,8 @@ WAJIC_LIB(GL, void, glVertexAttrib4f, (GLuint index, GLfloat x, GLfloat y, GLflo
 	GLctx.vertexAttrib4f(index, x, y, z, w);
 })
 
-WAJIC_LIB(GL, void, glVertexAttrib4fv, (GLuint index, const GLfloat *v),
+WAJIC_LIB(GL, void, glVertexAttrib4fv, (GLuint index, const GLfloat *WA_INDEX32(v)),
 {
-	v >>= 2;
 	GLctx.vertexAttrib4f(index, MF32[v], MF32[v+1], MF32[v+2], MF32[v+3]);
 })
 
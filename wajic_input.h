@@ -0,0 +1,157 @@
+/*
+  WAjic - WebAssembly JavaScript Interface Creator
+  Copyright (C) 2020 Bernhard Schelling
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include <wajic.h>
+
+// Types of input events stored in the queue
+enum
+{
+	WA_INPUT_KEY_DOWN = 1, // code is the key code
+	WA_INPUT_KEY_UP,       // code is the key code
+	WA_INPUT_TEXT,         // code is the unicode code point of the entered character
+	WA_INPUT_MOUSE_MOVE,   // x/y is the mouse position in canvas pixels (consecutive moves are coalesced)
+	WA_INPUT_MOUSE_DOWN,   // code is the mouse button, x/y is the mouse position
+	WA_INPUT_MOUSE_UP,     // code is the mouse button, x/y is the mouse position
+	WA_INPUT_WHEEL,        // x/y is the scroll delta (consecutive wheel events are summed up)
+	WA_INPUT_FOCUS,        // code is 1 when the window gained focus, 0 when it lost focus
+};
+
+// A single input event record (16 bytes)
+typedef struct WaInputEvent
+{
+	unsigned int type, code;
+	float x, y;
+} WaInputEvent;
+
+// Ring buffer in linear memory that event listeners in JavaScript append to
+// read and write are running counters, the event at a counter is stored at index (counter % capacity)
+typedef struct WaInputQueue
+{
+	unsigned int read, write, capacity;
+	unsigned int dropped;   // number of events dropped because the queue was full
+	unsigned int coalesced; // number of mouse move and wheel events that were merged into the previous event
+	unsigned int reserved[3];
+	WaInputEvent events[1];
+} WaInputQueue;
+
+// Allocate the input queue and register keyboard/mouse/focus listeners on WA.canvas and the window
+// The returned queue should be drained once per frame with WaInputDrain
+// Events can also be added from JavaScript with WA.inputPush(type, code, x, y) (for example to inject synthetic events)
+WAJIC_LIB_WITH_INIT(INPUT,
+(
+	var INq;
+
+	// Append an event to the queue or merge it into the last queued event if both are mouse moves or wheel scrolls
+	var INpush = WA.inputPush = function(type, code, x, y)
+	{
+		if (!INq) return;
+		var q = INq>>2, r = MU32[q], w = MU32[q+1], cap = MU32[q+2], e;
+		if (w != r && (type == 4 || type == 7))
+		{
+			e = q + 8 + ((w - 1) % cap) * 4;
+			if (MU32[e] == type)
+			{
+				if (type == 4) { MF32[e+2] = x; MF32[e+3] = y; }
+				else { MF32[e+2] += x; MF32[e+3] += y; }
+				MU32[q+4]++;
+				return;
+			}
+		}
+		if (w - r >= cap) { MU32[q+3]++; return; }
+		e = q + 8 + (w % cap) * 4;
+		MU32[e] = type;
+		MU32[e+1] = code;
+		MF32[e+2] = x;
+		MF32[e+3] = y;
+		MU32[q+1] = w + 1;
+	};
+),
+WaInputQueue*, WaInputInit, (unsigned int capacity WA_ARG(256)),
+{
+	if (INq) return INq;
+	INq = ASM.malloc(32 + capacity * 16);
+	MU32.fill(0, INq>>2, (INq>>2) + 8);
+	MU32[(INq>>2)+2] = capacity;
+	if (typeof window == 'undefined') return INq;
+
+	var canvas = WA.canvas, buttons = 0;
+	var cancelEvent = function(e) { if (e.preventDefault) e.preventDefault(true); else if (e.stopPropagation) e.stopPropagation(true); else e.stopped = true; };
+	var windowEvent = function(t, f) { window.addEventListener(t, f, true); };
+	var canvasEvent = function(t, f) { canvas.addEventListener(t, f, {capture:true,passive:false}); };
+	var mouseX = e => e.offsetX * canvas.width / canvas.clientWidth, mouseY = e => e.offsetY * canvas.height / canvas.clientHeight;
+
+	// Events on the window (like releasing a button outside of the canvas) have offsets relative to the element under the mouse,
+	// so these get calculated from the client coordinates like offsetX/offsetY are for events on the canvas
+	var windowMouseX = (e, r) => (e.clientX - r.left - canvas.clientLeft) * canvas.width / canvas.clientWidth;
+	var windowMouseY = (e, r) => (e.clientY - r.top - canvas.clientTop) * canvas.height / canvas.clientHeight;
+	windowEvent('keydown', function(e)
+	{
+		INpush(1, e.keyCode, 0, 0);
+		if ([...e.key].length == 1) INpush(3, e.key.codePointAt(0), 0, 0);
+		cancelEvent(e);
+	});
+	windowEvent('keyup', function(e)
+	{
+		INpush(2, e.keyCode, 0, 0);
+		cancelEvent(e);
+	});
+	windowEvent('focus', function(e) { INpush(8, 1, 0, 0); });
+	windowEvent('blur',  function(e) { INpush(8, 0, 0, 0); });
+	if (!canvas) return INq;
+	canvasEvent('mousemove', function(e)
+	{
+		INpush(4, 0, mouseX(e), mouseY(e));
+		cancelEvent(e);
+	});
+	canvasEvent('mousedown', function(e)
+	{
+		var btn = (1<<e.button);
+		if (buttons & btn) return;
+		buttons |= btn;
+		INpush(5, e.button, mouseX(e), mouseY(e));
+		cancelEvent(e);
+	});
+	windowEvent('mouseup', function(e)
+	{
+		var btn = (1<<e.button);
+		if (!(buttons & btn)) return;
+		var r = canvas.getBoundingClientRect();
+		buttons &= ~btn;
+		INpush(6, e.button, windowMouseX(e, r), windowMouseY(e, r));
+		cancelEvent(e);
+	});
+	canvasEvent('wheel',          function(e) { INpush(7, 0, e.deltaX, e.deltaY); cancelEvent(e); });
+	canvasEvent('DOMMouseScroll', function(e) { INpush(7, 0, 0, -e.detail*40);    cancelEvent(e); });
+	return INq;
+})
+
+// Copy up to max_events queued events into events and remove them from the queue, returns the number of events copied
+// This does not call into JavaScript, so it is cheap to call once per frame
+static inline unsigned int WaInputDrain(WaInputQueue* queue, WaInputEvent* events, unsigned int max_events)
+{
+	unsigned int n = 0, r = queue->read, w = queue->write;
+	for (; r != w && n != max_events; r++, n++)
+		events[n] = queue->events[r % queue->capacity];
+	queue->read = r;
+	return n;
+}
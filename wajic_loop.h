@@ -0,0 +1,163 @@
+/*
+  WAjic - WebAssembly JavaScript Interface Creator
+  Copyright (C) 2020 Bernhard Schelling
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include <wajic.h>
+
+// Frame statistics of the main loop (filled by WaLoopGetStats)
+// CPU time is the time spent in the update and render functions of a frame, percentiles have a precision of 0.1 milliseconds
+typedef struct WaLoopStats
+{
+	unsigned int frames;      // Number of rendered frames
+	unsigned int updates;     // Number of fixed time steps taken
+	unsigned int long_frames; // Number of frames with a CPU time over 50 milliseconds
+	unsigned int over_budget; // Number of frames with a CPU time over the frame budget (frame rate cap or 60 FPS)
+	float fps;                // Average frames per second
+	float cpu_avg, cpu_p50, cpu_p95, cpu_p99, cpu_max; // CPU time per frame in milliseconds
+} WaLoopStats;
+
+// Start the main loop which calls the render function once per display frame (with requestAnimationFrame)
+// The render function has the signature 'void Render(double time_ms, float alpha)' where time_ms is the time in
+// milliseconds since the loop started and alpha is the fraction of the next fixed time step that has already passed.
+// If an update function is passed, it gets called with the signature 'void Update(double step_ms)' at a fixed rate of
+// update_hz times per second before rendering (or not at all in a frame if rendering is faster than updating).
+// A max_fps value limits the rendering frame rate (0 renders on every display frame).
+// Under Node.js the loop runs with setImmediate instead (as fast as possible unless max_fps is set) for headless benchmarking.
+// Function and object names of the update and render functions need to be marked with WA_EXPORT.
+WAJIC_LIB_WITH_INIT(LOOP,
+(
+	var LPrender, LPupdate, LPstep, LPminFrame, LPstart, LPstatStart, LPlast, LPacc, LPrunning, LPtimer, LPclear, LPhist, LPframes, LPupdates, LPlong, LPbudget, LPcpuSum, LPcpuMax;
+	var LPnow = (typeof performance != 'undefined' ? () => performance.now() : () => Date.now());
+
+	// Reset the statistics, the histogram has 1000 buckets of 0.1 milliseconds (the last bucket also counts all longer frames)
+	var LPreset = function()
+	{
+		LPhist = new Uint32Array(1000);
+		LPframes = LPupdates = LPlong = LPbudget = LPcpuSum = LPcpuMax = 0;
+		LPstatStart = LPnow();
+	};
+
+	// Get the CPU time in milliseconds below which the given fraction of frames are
+	var LPpercentile = function(p)
+	{
+		for (var n = LPframes * p, sum = 0, i = 0; i != 1000; i++)
+			if ((sum += LPhist[i]) >= n && sum) return (i + 1) / 10;
+		return 0;
+	};
+
+	var LPtick = function()
+	{
+		if (STOP || !LPrunning) return;
+		var now = LPnow(), elapsed = now - LPlast;
+		if (elapsed < LPminFrame - 1) return LPschedule();
+		LPlast = now;
+
+		// Run the fixed time steps that have passed (but don't try to catch up after long breaks like an inactive browser tab)
+		if (LPupdate)
+			for (LPacc += Math.min(elapsed, 250); LPacc >= LPstep; LPacc -= LPstep, LPupdates++)
+				LPupdate(LPstep);
+		LPrender(now - LPstart, (LPupdate ? LPacc / LPstep : 0));
+
+		// Record the CPU time of this frame
+		var cpu = LPnow() - now;
+		LPhist[Math.min(cpu * 10, 999)|0]++;
+		LPframes++;
+		if (WA.timing && !WA.timing.frame) WA.timing.frame = LPnow() - WA.timing.start;
+		LPcpuSum += cpu;
+		if (cpu > LPcpuMax) LPcpuMax = cpu;
+		if (cpu > 50) LPlong++;
+		if (cpu > Math.max(LPminFrame, 1000/60)) LPbudget++;
+		LPschedule();
+	};
+
+	// The pending tick and the function to cancel it are kept so there is never more than one tick scheduled (even when the
+	// loop gets stopped and started again before the pending tick ran, which would otherwise leave two ticks running)
+	var LPcancelFrame = id => window.cancelAnimationFrame(id);
+	var LPcancel = function()
+	{
+		if (LPclear) LPclear(LPtimer);
+		LPclear = null;
+	};
+	var LPschedule = function()
+	{
+		LPcancel();
+		if (typeof window != 'undefined') { LPtimer = window.requestAnimationFrame(LPtick); LPclear = LPcancelFrame; }
+		else if (LPminFrame) { LPtimer = setTimeout(LPtick, Math.max(0, LPminFrame - (LPnow() - LPlast) - 1)); LPclear = clearTimeout; }
+		else { LPtimer = setImmediate(LPtick); LPclear = clearImmediate; }
+	};
+
+	// Get the current statistics as an object from JavaScript
+	WA.loopStats = function()
+	{
+		var secs = (LPnow() - LPstatStart) / 1000;
+		return { frames: LPframes, updates: LPupdates, long_frames: LPlong, over_budget: LPbudget, fps: (secs ? LPframes / secs : 0),
+			cpu_avg: (LPframes ? LPcpuSum / LPframes : 0), cpu_p50: LPpercentile(.5), cpu_p95: LPpercentile(.95), cpu_p99: LPpercentile(.99), cpu_max: LPcpuMax };
+	};
+),
+void, WaLoopStart, (const char* exported_renderfunc, const char* exported_updatefunc WA_ARG(0), unsigned int update_hz WA_ARG(60), unsigned int max_fps WA_ARG(0)),
+{
+	LPrender = ASM[MStrGet(exported_renderfunc)];
+	LPupdate = (exported_updatefunc ? ASM[MStrGet(exported_updatefunc)] : null);
+	if (!LPrender || (exported_updatefunc && !LPupdate)) throw 'bad callback';
+	LPstep = 1000 / (update_hz || 60);
+	LPminFrame = (max_fps ? 1000 / max_fps : 0);
+	LPacc = 0;
+	LPreset();
+	LPstart = LPlast = LPnow();
+	if (!LPrunning) { LPrunning = 1; LPschedule(); }
+})
+
+// Stop calling the update and render functions (the statistics stay available)
+WAJIC_LIB(LOOP, void, WaLoopStop, (),
+{
+	LPrunning = 0;
+	LPcancel();
+})
+
+// Change the frame rate cap of the running loop (0 renders on every display frame)
+WAJIC_LIB(LOOP, void, WaLoopSetMaxFPS, (unsigned int max_fps),
+{
+	LPminFrame = (max_fps ? 1000 / max_fps : 0);
+})
+
+// Get the frame statistics collected since the loop was started or the statistics were reset
+WAJIC_LIB(LOOP, void, WaLoopGetStats, (WaLoopStats* stats),
+{
+	var s = WA.loopStats();
+	stats >>= 2;
+	MU32[stats  ] = s.frames;
+	MU32[stats+1] = s.updates;
+	MU32[stats+2] = s.long_frames;
+	MU32[stats+3] = s.over_budget;
+	MF32[stats+4] = s.fps;
+	MF32[stats+5] = s.cpu_avg;
+	MF32[stats+6] = s.cpu_p50;
+	MF32[stats+7] = s.cpu_p95;
+	MF32[stats+8] = s.cpu_p99;
+	MF32[stats+9] = s.cpu_max;
+})
+
+// Reset the frame statistics
+WAJIC_LIB(LOOP, void, WaLoopResetStats, (),
+{
+	LPreset();
+})
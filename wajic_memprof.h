@@ -0,0 +1,316 @@
+/*
+  WAjic - WebAssembly JavaScript Interface Creator
+  Copyright (C) 2020 Bernhard Schelling
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+// Allocation profiler for builds with MEMPROF=1 in wajic.mk
+// The implementation replaces malloc, free, realloc, etc. of the system library with wrappers around emmalloc (or the
+// slab allocator of wajic_alloc.h with ALLOCATOR=slab) that put a 16 byte header in front of every allocation.
+// It tracks live and peak memory, a histogram of allocation sizes and detects freeing of invalid pointers.
+// Every Nth allocation records its call site from a JavaScript stack trace (with function names if the wasm file has
+// a name section, which MEMPROF=1 keeps) for a per call site leak report.
+// The report can be printed with WaMemProfReport or WA.memPrint() and is returned as an object by WA.memReport().
+// Under Node.js the report including all call sites that still have memory allocated is printed on exit.
+
+#pragma once
+
+#include <wajic.h>
+
+#if defined(WA_MEMPROF_IMPLEMENTATION) && !defined(WA_MEMPROF)
+#define WA_MEMPROF
+#endif
+
+// Memory statistics (filled by WaMemProfGetStats)
+typedef struct WaMemProfStats
+{
+	unsigned int live_bytes, live_allocs; // Currently allocated memory
+	unsigned int peak_bytes, peak_allocs; // Highest amount of allocated memory since startup
+	unsigned int total_allocs;            // Number of allocations since startup (including reallocations)
+	unsigned int total_frees;             // Number of frees since startup
+	unsigned int failed_allocs;           // Number of allocations that returned null
+	unsigned int bad_frees;               // Number of calls to free or realloc with a pointer that is not allocated
+	unsigned int heap_size;               // Size of the wasm memory in bytes
+	unsigned int size_classes[32];        // Number of allocations by size, index N counts sizes from 2^(N-1)+1 to 2^N bytes
+} WaMemProfStats;
+
+#ifdef WA_MEMPROF
+// Get the current memory statistics
+WA_EXTERN void WaMemProfGetStats(WaMemProfStats* stats);
+
+// Set how often call sites are recorded (1 records every allocation, 0 disables recording, the default is 32)
+WA_EXTERN void WaMemProfSetSampleRate(unsigned int every_nth_alloc);
+
+// Print the memory statistics and the allocation call sites with the most live memory
+WA_EXTERN void WaMemProfReport(void);
+#else
+#define WaMemProfGetStats(stats) ((void)0)
+#define WaMemProfSetSampleRate(every_nth_alloc) ((void)0)
+#define WaMemProfReport() ((void)0)
+#endif
+
+#ifdef WA_MEMPROF_IMPLEMENTATION
+
+#include <stddef.h>
+#include <string.h>
+
+// Number of distinct call sites that can be tracked (further call sites are counted as unsampled)
+#ifndef WA_MEMPROF_MAX_SITES
+#define WA_MEMPROF_MAX_SITES 1024
+#endif
+
+#ifndef WA_MEMPROF_SAMPLE_RATE
+#define WA_MEMPROF_SAMPLE_RATE 32
+#endif
+
+WAJIC_LIB_WITH_INIT(MEMPROF,
+(
+	var MPstats, MPsites, MPmaxSites, MPkeys = {}, MPstacks = ['(unsampled)'], MPbadFrees = 0;
+
+	// Get a short call stack of the wasm functions calling into the allocator
+	var MPstack = function()
+	{
+		var limit = Error.stackTraceLimit, stack;
+		Error.stackTraceLimit = 24;
+		stack = new Error().stack || '';
+		Error.stackTraceLimit = limit;
+		return stack.split('\n').filter(l => /wasm-function|wasm:/.test(l))
+			.map(l => l.replace(/^ *at +/, '').replace(/ +[(].*[)]$|@.*$/, '').replace(/^.*(wasm-function[[][0-9]+]).*$/, '$1'))
+			.filter(f => !/^(WaMemProf|malloc$|calloc$|realloc$|free$|memalign$|aligned_alloc$|posix_memalign$|_Zn[wa]|_Zd[la])/.test(f))
+			.slice(0, 6).join(' <- ') || '(unknown)';
+	};
+
+	WA.memReport = function()
+	{
+		if (!MPstats) return null;
+		var s = MPstats>>2, res = { live_bytes: MU32[s], live_allocs: MU32[s+1], peak_bytes: MU32[s+2], peak_allocs: MU32[s+3],
+			total_allocs: MU32[s+4], total_frees: MU32[s+5], failed_allocs: MU32[s+6], bad_frees: MU32[s+7], heap_size: MEM.buffer.byteLength,
+			size_classes: Array.from(MU32.subarray(s+9, s+41)), sites: [] };
+		for (var i = 0; i != MPstacks.length; i++)
+		{
+			var e = (MPsites>>2) + i * 3;
+			if (MU32[e+2]) res.sites.push({ stack: MPstacks[i], live_allocs: MU32[e], live_bytes: MU32[e+1], allocs: MU32[e+2] });
+		}
+		res.sites.sort((a, b) => b.live_bytes - a.live_bytes);
+		return res;
+	};
+
+	// Print the report, if leaks is set only call sites with memory still allocated are listed
+	WA.memPrint = function(leaks)
+	{
+		var r = WA.memReport(), txt = '', cls = [], n = 0;
+		if (!r) return;
+		r.size_classes.forEach((c, i) => { if (c) cls.push('<=' + (2**i) + ': ' + c); });
+		txt += 'Memory: ' + r.live_bytes + ' bytes in ' + r.live_allocs + ' allocations live, peak ' + r.peak_bytes + ' bytes in ' + r.peak_allocs + ' allocations, heap ' + r.heap_size + ' bytes' + "\n";
+		txt += 'Allocations: ' + r.total_allocs + ' allocs, ' + r.total_frees + ' frees, ' + r.failed_allocs + ' failed, ' + r.bad_frees + ' bad frees' + "\n";
+		txt += 'Sizes: ' + cls.join(', ') + "\n";
+		txt += (leaks ? 'Sampled call sites with memory still allocated:' : 'Sampled call sites by live memory:') + "\n";
+		r.sites.forEach(s => { if ((!leaks || s.live_allocs) && n++ < 20) txt += '  ' + ('         ' + s.live_bytes).slice(-10) + ' bytes ' + ('      ' + s.live_allocs).slice(-7) + ' live ' + ('      ' + s.allocs).slice(-7) + ' total  ' + s.stack + "\n"; });
+		WA.print(txt);
+	};
+
+	if ((typeof process)[0]=='o') process.on('exit', function() { WA.memPrint(1); });
+),
+void, WaMemProf_Start, (WaMemProfStats* stats, unsigned int* sites, unsigned int max_sites),
+{
+	MPstats = stats;
+	MPsites = sites;
+	MPmaxSites = max_sites;
+})
+
+// Get the call site index of the current allocation
+WAJIC_LIB(MEMPROF, unsigned int, WaMemProf_Site, (),
+{
+	var key = MPstack(), site = MPkeys[key];
+	if (site === undefined)
+	{
+		if (MPstacks.length == MPmaxSites) return 0;
+		site = MPkeys[key] = MPstacks.length;
+		MPstacks.push(key);
+	}
+	return site;
+})
+
+WAJIC_LIB(MEMPROF, void, WaMemProf_BadFree, (void* ptr),
+{
+	if (MPbadFrees++ < 10) WA.print('Warning: Freeing invalid or already freed pointer ' + ptr + ' in ' + MPstack() + "\n");
+})
+
+WAJIC_LIB(MEMPROF, void, WaMemProfReport, (),
+{
+	WA.memPrint(0);
+})
+
+// The wrapped allocator functions (emmalloc in the system library or the slab allocator of wajic_alloc.h)
+#ifndef WA_MEMPROF_MALLOC
+#define WA_MEMPROF_MALLOC emmalloc_malloc
+#define WA_MEMPROF_MEMALIGN emmalloc_memalign
+#define WA_MEMPROF_REALLOC emmalloc_realloc
+#define WA_MEMPROF_FREE emmalloc_free
+#endif
+WA_EXTERN void* WA_MEMPROF_MALLOC(size_t size);
+WA_EXTERN void* WA_MEMPROF_MEMALIGN(size_t alignment, size_t size);
+WA_EXTERN void* WA_MEMPROF_REALLOC(void* ptr, size_t size);
+WA_EXTERN void WA_MEMPROF_FREE(void* ptr);
+
+// Header in front of every allocation, offset is the distance to the start of the wrapped allocation
+typedef struct WaMemProf_Header { unsigned int size, site, offset, magic; } WaMemProf_Header;
+enum { WA_MEMPROF_MAGIC = 0x4D454D50, WA_MEMPROF_FREED = 0x46524545 };
+
+static struct
+{
+	WaMemProfStats stats;
+	unsigned int sites[WA_MEMPROF_MAX_SITES][3]; // live allocations, live bytes and total allocations per call site
+	unsigned int started, sample_rate, sample_counter;
+} WaMemProf = { {0}, {{0}}, 0, WA_MEMPROF_SAMPLE_RATE, 0 };
+
+static void WaMemProf_Add(WaMemProf_Header* h, size_t size)
+{
+	WaMemProfStats* s = &WaMemProf.stats;
+	unsigned int site = 0;
+	if (!WaMemProf.started) { WaMemProf.started = 1; WaMemProf_Start(s, &WaMemProf.sites[0][0], WA_MEMPROF_MAX_SITES); }
+	if (WaMemProf.sample_rate && ++WaMemProf.sample_counter >= WaMemProf.sample_rate) { WaMemProf.sample_counter = 0; site = WaMemProf_Site(); }
+	h->size = (unsigned int)size;
+	h->site = site;
+	h->magic = WA_MEMPROF_MAGIC;
+	WaMemProf.sites[site][0]++;
+	WaMemProf.sites[site][1] += h->size;
+	WaMemProf.sites[site][2]++;
+	s->size_classes[size > 1 ? 32 - __builtin_clz((unsigned int)size - 1) : 0]++;
+	s->total_allocs++;
+	s->live_bytes += h->size;
+	if (s->live_bytes > s->peak_bytes) s->peak_bytes = s->live_bytes;
+	if (++s->live_allocs > s->peak_allocs) s->peak_allocs = s->live_allocs;
+}
+
+static void WaMemProf_Remove(WaMemProf_Header* h)
+{
+	WaMemProf.sites[h->site][0]--;
+	WaMemProf.sites[h->site][1] -= h->size;
+	WaMemProf.stats.live_bytes -= h->size;
+	WaMemProf.stats.live_allocs--;
+	WaMemProf.stats.total_frees++;
+	h->magic = WA_MEMPROF_FREED;
+}
+
+static WaMemProf_Header* WaMemProf_Get(void* ptr)
+{
+	WaMemProf_Header* h = (WaMemProf_Header*)ptr - 1;
+	if (((size_t)ptr & 7) || (size_t)ptr < sizeof(WaMemProf_Header) || h->magic != WA_MEMPROF_MAGIC)
+	{
+		WaMemProf.stats.bad_frees++;
+		WaMemProf_BadFree(ptr);
+		return 0;
+	}
+	return h;
+}
+
+static void* WaMemProf_Alloc(size_t alignment, size_t size)
+{
+	char* base;
+	size_t offset = (alignment > sizeof(WaMemProf_Header) ? alignment : sizeof(WaMemProf_Header));
+	if (size > (size_t)-1 - offset) base = 0;
+	else if (alignment <= 8) base = (char*)WA_MEMPROF_MALLOC(offset + size);
+	else base = (char*)WA_MEMPROF_MEMALIGN(alignment, offset + size);
+	if (!base) { WaMemProf.stats.failed_allocs++; return 0; }
+	((WaMemProf_Header*)(base + offset) - 1)->offset = (unsigned int)offset;
+	WaMemProf_Add((WaMemProf_Header*)(base + offset) - 1, size);
+	return base + offset;
+}
+
+WA_EXTERN void* malloc(size_t size)
+{
+	return WaMemProf_Alloc(8, size);
+}
+
+WA_EXTERN void* memalign(size_t alignment, size_t size)
+{
+	return WaMemProf_Alloc(alignment, size);
+}
+
+WA_EXTERN void* aligned_alloc(size_t alignment, size_t size)
+{
+	return WaMemProf_Alloc(alignment, size);
+}
+
+WA_EXTERN int posix_memalign(void** res, size_t alignment, size_t size)
+{
+	void* ptr = WaMemProf_Alloc(alignment, size);
+	if (!ptr) return 12; //ENOMEM
+	*res = ptr;
+	return 0;
+}
+
+WA_EXTERN void* calloc(size_t num, size_t size)
+{
+	void* ptr = (size && num > (size_t)-1 / size ? 0 : WaMemProf_Alloc(8, num * size));
+	if (ptr) memset(ptr, 0, num * size);
+	return ptr;
+}
+
+WA_EXTERN void free(void* ptr)
+{
+	WaMemProf_Header* h;
+	if (!ptr || !(h = WaMemProf_Get(ptr))) return;
+	WaMemProf_Remove(h);
+	WA_MEMPROF_FREE((char*)ptr - h->offset);
+}
+
+WA_EXTERN void* realloc(void* ptr, size_t size)
+{
+	WaMemProf_Header *h, copy;
+	char* base;
+	if (!ptr) return malloc(size);
+	if (!size) { free(ptr); return 0; }
+	if (!(h = WaMemProf_Get(ptr))) return 0;
+	if (h->offset != sizeof(WaMemProf_Header))
+	{
+		// Aligned allocations are moved into a regular allocation
+		void* res = malloc(size);
+		if (!res) return 0;
+		memcpy(res, ptr, (size < h->size ? size : h->size));
+		free(ptr);
+		return res;
+	}
+	copy = *h;
+	base = (size > (size_t)-1 - sizeof(WaMemProf_Header) ? 0 : (char*)WA_MEMPROF_REALLOC(h, sizeof(WaMemProf_Header) + size));
+	if (!base) { WaMemProf.stats.failed_allocs++; return 0; }
+	WaMemProf_Remove(&copy);
+	((WaMemProf_Header*)base)->offset = sizeof(WaMemProf_Header);
+	WaMemProf_Add((WaMemProf_Header*)base, size);
+	return base + sizeof(WaMemProf_Header);
+}
+
+WA_EXTERN size_t malloc_usable_size(void* ptr)
+{
+	return (ptr ? ((WaMemProf_Header*)ptr - 1)->size : 0);
+}
+
+WA_EXTERN void WaMemProfGetStats(WaMemProfStats* stats)
+{
+	*stats = WaMemProf.stats;
+	stats->heap_size = (unsigned int)__builtin_wasm_memory_size(0) * 65536;
+}
+
+WA_EXTERN void WaMemProfSetSampleRate(unsigned int every_nth_alloc)
+{
+	WaMemProf.sample_rate = every_nth_alloc;
+	WaMemProf.sample_counter = 0;
+}
+
+#endif //WA_MEMPROF_IMPLEMENTATION
@@ -0,0 +1,205 @@
+/*
+  WAjic - WebAssembly JavaScript Interface Creator
+  Copyright (C) 2020 Bernhard Schelling
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+// Multi-voice audio mixer with per-voice gain, pan and pitch and linear or cubic resampling
+// The output is written as non-interleaved stereo which matches the render function layout of wajic_audio.h
+// When compiled with wasm SIMD enabled (SIMD=1 in wajic.mk), the resampling and mixing kernels process 4 frames at once
+
+#pragma once
+
+#if defined(__wasm_simd128__) && !defined(WA_MIXER_NO_SIMD)
+#define WA_MIXER_SIMD 1
+typedef float WaMixerF4 __attribute__((vector_size(16), aligned(4)));
+typedef int WaMixerI4 __attribute__((vector_size(16), aligned(4)));
+#else
+#define WA_MIXER_SIMD 0
+#endif
+
+#include <math.h>
+
+// Interpolation modes used to resample voices
+enum { WA_MIXER_LINEAR, WA_MIXER_CUBIC };
+
+typedef struct WaMixerVoice
+{
+	const float* samples;        // Mono source sample data (0 if the voice is not playing)
+	unsigned int length;         // Number of frames in samples
+	unsigned int loop_start;     // Frame where playback continues when reaching the end (if loop is set)
+	int loop;                    // Set to loop the voice, otherwise it stops at the end
+	float gain;                  // Volume of the voice (1.0 is full volume)
+	float pan;                   // Stereo panning (-1.0 is left, 0.0 is center, 1.0 is right)
+	float pitch;                 // Playback rate (1.0 plays the source at the output rate, 2.0 one octave higher, etc.)
+	unsigned long long position; // Current playback position in 32.32 fixed point frames
+} WaMixerVoice;
+
+typedef struct WaMixer
+{
+	WaMixerVoice* voices;        // Array of voices
+	unsigned int num_voices;     // Number of voices in the array
+	int interpolation;           // WA_MIXER_LINEAR or WA_MIXER_CUBIC
+	float master_gain;           // Volume applied to the mix bus before clipping
+} WaMixer;
+
+// Initialize a mixer with a user provided array of voices
+static void WaMixerInit(WaMixer* mixer, WaMixerVoice* voices, unsigned int num_voices, int interpolation)
+{
+	unsigned int i;
+	mixer->voices = voices;
+	mixer->num_voices = num_voices;
+	mixer->interpolation = interpolation;
+	mixer->master_gain = 1.0f;
+	for (i = 0; i != num_voices; i++) voices[i].samples = 0;
+}
+
+// Start playing a sample on a free voice, returns the voice index or -1 if all voices are busy
+static int WaMixerPlay(WaMixer* mixer, const float* samples, unsigned int length, float gain, float pan, float pitch, int loop)
+{
+	unsigned int i;
+	for (i = 0; i != mixer->num_voices; i++)
+	{
+		WaMixerVoice* v = &mixer->voices[i];
+		if (v->samples) continue;
+		v->samples = samples;
+		v->length = length;
+		v->loop_start = 0;
+		v->loop = loop;
+		v->gain = gain;
+		v->pan = pan;
+		v->pitch = pitch;
+		v->position = 0;
+		return (int)i;
+	}
+	return -1;
+}
+
+// Read a source frame of a voice with the index wrapped around the loop or clamped to the sample range
+static float WaMixer_Frame(const WaMixerVoice* v, long long i)
+{
+	if (i < 0) i = 0;
+	if (i >= (long long)v->length)
+	{
+		if (!v->loop || v->loop_start >= v->length) return 0.0f;
+		i = v->loop_start + (i - v->length) % (v->length - v->loop_start);
+	}
+	return v->samples[i];
+}
+
+static float WaMixer_Interpolate(int interpolation, float s0, float s1, float s2, float s3, float t)
+{
+	if (interpolation == WA_MIXER_LINEAR) return s1 + (s2 - s1) * t;
+	// Catmull-Rom spline through the 4 source frames around the position
+	return ((((-0.5f*s0 + 1.5f*s1 - 1.5f*s2 + 0.5f*s3) * t + (s0 - 2.5f*s1 + 2.0f*s2 - 0.5f*s3)) * t + (-0.5f*s0 + 0.5f*s2)) * t + s1);
+}
+
+// Resample a voice and add it onto the stereo mix bus
+static void WaMixer_MixVoice(const WaMixer* mixer, WaMixerVoice* v, float* left, float* right, unsigned int frames)
+{
+	const float angle = (v->pan < -1.0f ? 0.0f : v->pan > 1.0f ? 2.0f : v->pan + 1.0f) * 0.78539816f;
+	const float gl = v->gain * cosf(angle), gr = v->gain * sinf(angle);
+	const unsigned long long step = (unsigned long long)(v->pitch * 4294967296.0);
+	const int interp = mixer->interpolation;
+	unsigned long long pos = v->position;
+	unsigned int f = 0;
+	while (f != frames)
+	{
+		long long idx = (long long)(pos >> 32);
+		if (idx >= (long long)v->length)
+		{
+			// Reached the end of the source, either wrap around the loop or stop the voice
+			if (!v->loop || v->loop_start >= v->length) { v->samples = 0; return; }
+			pos -= (unsigned long long)(v->length - v->loop_start) << 32;
+			continue;
+		}
+
+		#if WA_MIXER_SIMD
+		// Number of frames that can be processed without any of the 4 needed source frames leaving the sample range
+		if (idx >= 1 && idx + 3 < (long long)v->length && step)
+		{
+			unsigned long long run = ((((unsigned long long)v->length - 3) << 32) - pos + step - 1) / step;
+			if (run > frames - f) run = frames - f;
+			const float* s = v->samples;
+			const WaMixerF4 vgl = { gl, gl, gl, gl }, vgr = { gr, gr, gr, gr };
+			for (run &= ~3ull; run; run -= 4, f += 4, pos += step * 4)
+			{
+				const unsigned long long p0 = pos, p1 = pos + step, p2 = p1 + step, p3 = p2 + step;
+				const float* a = s + (p0 >> 32); const float* b = s + (p1 >> 32); const float* c = s + (p2 >> 32); const float* d = s + (p3 >> 32);
+				const WaMixerF4 t = { (unsigned int)p0 * 2.3283064e-10f, (unsigned int)p1 * 2.3283064e-10f, (unsigned int)p2 * 2.3283064e-10f, (unsigned int)p3 * 2.3283064e-10f };
+				const WaMixerF4 s1 = { a[0], b[0], c[0], d[0] }, s2 = { a[1], b[1], c[1], d[1] };
+				WaMixerF4 out;
+				if (interp == WA_MIXER_LINEAR) out = s1 + (s2 - s1) * t;
+				else
+				{
+					const WaMixerF4 s0 = { a[-1], b[-1], c[-1], d[-1] }, s3 = { a[2], b[2], c[2], d[2] };
+					out = ((((s3 - s0) * 0.5f + (s1 - s2) * 1.5f) * t + (s0 - s1 * 2.5f + s2 * 2.0f - s3 * 0.5f)) * t + (s2 - s0) * 0.5f) * t + s1;
+				}
+				*(WaMixerF4*)(left + f) += out * vgl;
+				*(WaMixerF4*)(right + f) += out * vgr;
+			}
+			if (f == frames) break;
+			idx = (long long)(pos >> 32);
+		}
+		#endif
+
+		{
+			// Scalar path for a single frame (handles loop wrapping and sample range edges)
+			const float t = (unsigned int)pos * 2.3283064e-10f;
+			float out;
+			if (interp == WA_MIXER_LINEAR) out = WaMixer_Interpolate(interp, 0.0f, WaMixer_Frame(v, idx), WaMixer_Frame(v, idx + 1), 0.0f, t);
+			else out = WaMixer_Interpolate(interp, WaMixer_Frame(v, idx - 1), WaMixer_Frame(v, idx), WaMixer_Frame(v, idx + 1), WaMixer_Frame(v, idx + 2), t);
+			left[f] += out * gl;
+			right[f] += out * gr;
+			pos += step;
+			f++;
+		}
+	}
+	v->position = pos;
+}
+
+// Mix all playing voices into a non-interleaved stereo buffer (frames left samples followed by frames right samples)
+// The output buffer is used as the float mix bus, the result is scaled by master_gain and clipped to [-1, 1]
+static void WaMixerMix(WaMixer* mixer, float* output, unsigned int frames)
+{
+	float *left = output, *right = output + frames, g = mixer->master_gain;
+	unsigned int i = 0, n = frames * 2;
+	for (; i != n; i++) output[i] = 0.0f;
+
+	for (i = 0; i != mixer->num_voices; i++)
+		if (mixer->voices[i].samples)
+			WaMixer_MixVoice(mixer, &mixer->voices[i], left, right, frames);
+
+	i = 0;
+	#if WA_MIXER_SIMD
+	{
+		const WaMixerF4 vg = { g, g, g, g }, lo = { -1.0f, -1.0f, -1.0f, -1.0f }, hi = { 1.0f, 1.0f, 1.0f, 1.0f };
+		for (; i + 4 <= n; i += 4)
+		{
+			WaMixerF4 x = *(WaMixerF4*)(output + i) * vg;
+			WaMixerI4 below = (x < lo), above = (x > hi);
+			*(WaMixerF4*)(output + i) = (WaMixerF4)(((WaMixerI4)x & ~(below | above)) | ((WaMixerI4)lo & below) | ((WaMixerI4)hi & above));
+		}
+	}
+	#endif
+	for (; i != n; i++)
+	{
+		float x = output[i] * g;
+		output[i] = (x < -1.0f ? -1.0f : x > 1.0f ? 1.0f : x);
+	}
+}
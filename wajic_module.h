@@ -0,0 +1,154 @@
+/*
+  WAjic - WebAssembly JavaScript Interface Creator
+  Copyright (C) 2020 Bernhard Schelling
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+// Loading of side modules at runtime (dynamic linking) to keep rarely used code out of the initial download
+// Side modules are position independent wasm files (built with SIDE_MODULE=1 in wajic.mk) which share the memory, function table
+// and stack of the main module (which needs to be built with MAIN_MODULE=1). Their static data gets placed into memory allocated
+// with malloc and their functions at the end of the function table. Functions and data the side module uses from the main module
+// must be exported by it (with WA_EXPORT or MAIN_EXPORTS in wajic.mk). Functions that are called across modules can't have 64-bit
+// integer parameters because only the main module gets legalized for JavaScript by wasm-opt. Side modules can contain WAJIC functions
+// which can use the loader functions the main module uses (like MU8 or MStrGet), but a library with an init block gets its own
+// separate state in each module (i.e. a side module can't draw into the WebGL context of the main module with wajic_gl.h directly).
+
+#pragma once
+
+#include <wajic.h>
+
+// Load a side module from a file embedded with wajicup.js -embed or from a URL and pass the module (or 0 on error) to a callback
+// that has been marked with WA_EXPORT. The callback has the signature void callback(int module, void* userdata)
+WAJIC_LIB_WITH_INIT(MODULE,
+(
+	var MODlist = [], MODfuncs = new Map();
+
+	// Add a function to the function table of the main module and return its index (the function pointer value)
+	var MODaddFunc = function(f)
+	{
+		var table = ASM.__indirect_function_table, idx = MODfuncs.get(f);
+		if (idx) return idx;
+		table.grow(1);
+		table.set(idx = table.length - 1, f);
+		MODfuncs.set(f, idx);
+		return idx;
+	};
+
+	// Read the memory and table size needed by a side module from its dylink.0 custom section (or the older dylink section)
+	var MODgetDylink = function(mod)
+	{
+		var sec = WebAssembly.Module.customSections(mod, 'dylink.0')[0], old = !sec, i = 0, a;
+		if (old && !(sec = WebAssembly.Module.customSections(mod, 'dylink')[0])) return;
+		a = new Uint8Array(sec);
+		var Get = () => { for (var b, r = 0, x = 0; r |= ((b = a[i++])&127)<<x, b>>7; x += 7); return r; };
+
+		// The dylink.0 section consists of subsections of which the memory info has type 1 (the old section only has the memory info)
+		while (!old && i < a.length && a[i] != 1) { i++; i = Get() + i; }
+		if (!old) { i++; Get(); }
+		if (i >= a.length) return;
+		return { memSize: Get(), memAlign: Get(), tableSize: Get(), tableAlign: Get() };
+	};
+
+	// Generate the WAJIC functions of a side module (evaluated in the scope of the loader just like the ones of the main module)
+	var MODwajic = function(mod)
+	{
+		var libs = {}, res = {}, split = String.fromCharCode(17);
+		WebAssembly.Module.imports(mod).forEach(imp =>
+		{
+			if (imp.module != 'J') return;
+			var [name, args, code, lib, init] = imp.name.split(split), l = libs[lib || ''] || (libs[lib || ''] = { init: '', funcs: [] });
+			if (init) l.init += init.trim().slice(1, -1) + ';';
+
+			// Turn typed array and index annotations (like 'float* WA_F32ARRAY(p, n)') into code at the start of the function
+			var pre = '';
+			args = args.replace(/WA_(U8|U16|U32|I32|F32)ARRAY[(]([^,]*),((?:[^()]|[(][^()]*[)])*)[)]|WA_INDEX(16|32)[(]([A-Za-z_0-9 ]*)[)]/g, (m, heap, arr, len, bits, idx) =>
+			{
+				var shift = (heap ? Math.log2(heap.slice(1) / 8) : bits / 16);
+				pre += (heap ? (arr = arr.trim()) + '=MView(M' + heap + ',' + arr + (shift ? '>>' + shift : '') + ',' + len + ');' : (idx = idx.trim()) + '>>=' + shift + ';');
+				return arr || idx;
+			});
+			if (pre) code = (code.trim()[0] == '{' ? code.replace('{', '{' + pre) : '{' + pre + 'return(' + code + ')}');
+
+			// Reduce the C argument list to the parameter names (change '(float p1[20], unsigned int* p2 WA_ARG(0))' to 'p1,p2')
+			args = args.trim().replace(/^[(]|[)]$/g, '').trim();
+			args = (args == 'void' ? '' : args.split(',').map(a => a.replace(/WA_ARG.*|[[].*|=.*/, '').trim().match(/[A-Za-z_0-9]*$/)[0]).join());
+			l.funcs.push(JSON.stringify(imp.name) + ':(' + args + ')=>' + code);
+		});
+		for (var lib in libs) Object.assign(res, eval('(function(){' + libs[lib].init + 'return {' + libs[lib].funcs.join() + '};})()'));
+		return res;
+	};
+
+	// Compile and instantiate a side module, then resolve its global offset table, apply data relocations and call its constructors
+	var MODinstantiate = function(bytes)
+	{
+		return WebAssembly.compile(bytes).then(mod =>
+		{
+			var info = MODgetDylink(mod), table = ASM.__indirect_function_table, got = [];
+			if (!info) throw 'Not a side module (no dylink section)';
+			if (!table || !ASM.__stack_pointer) throw 'The main module needs to export the function table and the stack pointer (build with MAIN_MODULE=1)';
+
+			var align = 1 << info.memAlign, mem = info.memSize && ASM.malloc(info.memSize + align), memBase = (mem + align - 1) & -align, tableBase = table.length;
+			if (info.memSize && !mem) throw 'Out of memory';
+			if (info.memSize) MU8.fill(0, memBase, memBase + info.memSize);
+			if (info.tableSize) table.grow(info.tableSize);
+
+			var Global = (value, mutable) => new WebAssembly.Global({ value: 'i32', mutable: !!mutable }, value);
+			var env = { memory: ASM.memory || MEM, __indirect_function_table: table, __stack_pointer: ASM.__stack_pointer, __memory_base: Global(memBase), __table_base: Global(tableBase) };
+			var imports = { env: env, J: MODwajic(mod), 'GOT.mem': {}, 'GOT.func': {} };
+			WebAssembly.Module.imports(mod).forEach(imp =>
+			{
+				var m = imp.module, name = imp.name;
+				if (m == 'GOT.mem' || m == 'GOT.func') got.push([ imports[m][name] = Global(0, true), name, m == 'GOT.func' ]);
+				else if (m == 'env' && !env[name]) env[name] = ASM[name] || (() => abort('MODULE', 'Function ' + name + ' is not exported by the main module'));
+				else if (!imports[m]) throw 'Unsupported import ' + m + '.' + name;
+			});
+
+			return WebAssembly.instantiate(mod, imports).then(inst =>
+			{
+				// Symbols in the global offset table are either defined by the side module itself or exported by the main module
+				var exports = inst.exports;
+				got.forEach(([g, name, isFunc]) =>
+				{
+					var own = exports[name], e = own || ASM[name];
+					if (!e) throw 'Symbol ' + name + ' is not exported by the main module';
+					g.value = (isFunc ? MODaddFunc(e) : e.value + (own ? memBase : 0));
+				});
+				if (exports.__wasm_apply_data_relocs) exports.__wasm_apply_data_relocs();
+				if (exports.__wasm_call_ctors) exports.__wasm_call_ctors();
+				return MODlist.push({ exports: exports, memBase: memBase });
+			});
+		});
+	};
+),
+void, WaLoadModule, (const char* exported_callback, const char* url_or_name, void* userdata WA_ARG(0)),
+{
+	var cb = ASM[MStrGet(exported_callback)], name = MStrGet(url_or_name), embed = WebAssembly.Module.customSections(WM, '|' + name)[0];
+	if (!cb) throw 'bad callback';
+	(embed ? Promise.resolve(embed)
+		: (typeof process)[0]=='o' ? require('fs').promises.readFile(name)
+		: fetch(name).then(r => { if (!r.ok) throw 'HTTP status ' + r.status; return r.arrayBuffer(); }))
+	.then(MODinstantiate)
+	.then(module => cb(module, userdata), err => { WA.error('MODULE', 'Loading ' + name + ' failed: ' + err); cb(0, userdata); });
+})
+
+// Get the address of a function (usable as a function pointer) or of data exported by a loaded side module (0 if not found)
+WAJIC_LIB(MODULE, void*, WaModuleSymbol, (int module, const char* name),
+{
+	var m = MODlist[module - 1], e = m && m.exports[MStrGet(name)];
+	return (!e ? 0 : typeof e == 'function' ? MODaddFunc(e) : m.memBase + e.value);
+})
@@ -0,0 +1,129 @@
+/*
+  WAjic - WebAssembly JavaScript Interface Creator
+  Copyright (C) 2020 Bernhard Schelling
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+// Profile counter writer for builds with PGO=instrument in wajic.mk (profile-guided optimization)
+// Clang's instrumentation stores the counters of every function in linear memory. There is no profile runtime for wasm,
+// so this provides the functions the instrumented code calls at startup and writes the counters in the raw profile format
+// of LLVM (raw versions 8 to 10, as written by the profile runtime of clang 14 to 19) which llvm-profdata can merge.
+// Under Node.js the profile is written on exit to WA.pgoFile, $LLVM_PROFILE_FILE or default.profraw (%p is replaced with the process id).
+// In the browser it can be retrieved with WA.pgoData() (as an Uint8Array) or downloaded with WA.pgoSave().
+
+#pragma once
+
+#include <wajic.h>
+
+#ifdef WA_PGO_IMPLEMENTATION
+
+WAJIC_LIB_WITH_INIT(PGO,
+(
+	var PGinfo;
+
+	// Build the raw profile from the header fields and the profile sections in linear memory (all sections padded to 8 bytes)
+	WA.pgoData = function()
+	{
+		if (!PGinfo) return null;
+		var i = PGinfo>>2, ver = MU32[i+8]>>2, raw = MU32[ver];
+		var dataBeg = MU32[i], cntsBeg = MU32[i+2], bitsBeg = MU32[i+4], namesBeg = MU32[i+6];
+		var dataLen = MU32[i+1] - dataBeg, cntsLen = MU32[i+3] - cntsBeg, bitsLen = MU32[i+5] - bitsBeg, namesLen = MU32[i+7] - namesBeg;
+		if (raw < 8 || raw > 10) { WA.print('Unsupported raw profile version ' + raw + "\n"); return null; }
+
+		// Use the number of registered functions or the size of a data record on wasm32 (40 bytes, 48 with the bitmap fields of version 9)
+		var numData = (MU32[i+9] || dataLen / (raw >= 9 ? 48 : 40));
+
+		var pad = n => (8 - n % 8) % 8, hdr = [], Put = v => hdr.push(v, v < 0 ? -1 : 0);
+		hdr.push(0x6F665281, 0xFF6C7072, MU32[ver], MU32[ver+1]); // 32-bit magic and the version (with variant flags) from the module
+		Put(0); // binary ids size
+		Put(numData); Put(pad(dataLen)); Put(cntsLen / 8); Put(pad(cntsLen));
+		if (raw >= 9) { Put(bitsLen); Put(pad(bitsLen)); }
+		Put(namesLen);
+		Put(cntsBeg - dataBeg);
+		if (raw >= 9) Put(bitsBeg - dataBeg);
+		Put(namesBeg);
+		if (raw >= 10) { Put(0); Put(0); } // no virtual table profiling
+		Put(raw >= 10 ? 2 : 1); // last value profiling kind
+
+		var parts = [ new Uint8Array(new Uint32Array(hdr).buffer) ], len = 0;
+		[ [dataBeg, dataLen], [cntsBeg, cntsLen], [bitsBeg, (raw >= 9 ? bitsLen : 0)], [namesBeg, namesLen] ].forEach(s =>
+		{
+			if (s[1]) parts.push(MU8.slice(s[0], s[0] + s[1]), new Uint8Array(pad(s[1])));
+		});
+		parts.forEach(p => len += p.length);
+		var res = new Uint8Array(len);
+		len = 0;
+		parts.forEach(p => { res.set(p, len); len += p.length; });
+		return res;
+	};
+
+	WA.pgoSave = function(name)
+	{
+		var a = document.createElement('a');
+		a.href = URL.createObjectURL(new Blob([WA.pgoData()]));
+		a.download = name || 'default.profraw';
+		a.click();
+	};
+
+	if ((typeof process)[0]=='o') process.on('exit', function()
+	{
+		var path = (WA.pgoFile || process.env.LLVM_PROFILE_FILE || 'default.profraw').replace(/%p/g, process.pid), data = WA.pgoData();
+		if (!data) return;
+		require('fs').writeFileSync(path, data);
+		WA.print('Wrote profile counters to ' + path + "\n");
+	});
+),
+void, WaPgo_Start, (const void* info),
+{
+	PGinfo = info;
+})
+
+// Bounds of the profile sections, wasm-ld defines start/stop symbols for data segments that have a C identifier as their name
+extern char __start___llvm_prf_data[] __attribute__((weak)), __stop___llvm_prf_data[] __attribute__((weak));
+extern char __start___llvm_prf_cnts[] __attribute__((weak)), __stop___llvm_prf_cnts[] __attribute__((weak));
+extern char __start___llvm_prf_bits[] __attribute__((weak)), __stop___llvm_prf_bits[] __attribute__((weak));
+extern char __start___llvm_prf_names[] __attribute__((weak)), __stop___llvm_prf_names[] __attribute__((weak));
+extern const unsigned long long __llvm_profile_raw_version __attribute__((weak));
+
+static struct { const char *data_begin, *data_end, *cnts_begin, *cnts_end, *bits_begin, *bits_end, *names_begin, *names_end; const unsigned long long* version; unsigned int num_data; } WaPgo_Info =
+{
+	__start___llvm_prf_data, __stop___llvm_prf_data, __start___llvm_prf_cnts, __stop___llvm_prf_cnts,
+	__start___llvm_prf_bits, __stop___llvm_prf_bits, __start___llvm_prf_names, __stop___llvm_prf_names, &__llvm_profile_raw_version, 0
+};
+
+// Referenced by the instrumented code to pull in the profile runtime
+WA_EXTERN int __llvm_profile_runtime;
+int __llvm_profile_runtime;
+
+__attribute__((constructor)) static void WaPgo_Init(void)
+{
+	WaPgo_Start(&WaPgo_Info);
+}
+
+// The instrumentation registers the data record of every function from a constructor on targets without section bounds support
+WA_EXTERN void __llvm_profile_register_function(void* data)
+{
+	WaPgo_Info.num_data++;
+}
+
+WA_EXTERN void __llvm_profile_register_names_function(void* names, unsigned long long size)
+{
+}
+
+#endif //WA_PGO_IMPLEMENTATION
@@ -0,0 +1,172 @@
+/*
+  WAjic - WebAssembly JavaScript Interface Creator
+  Copyright (C) 2020 Bernhard Schelling
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+// Function level profiler for builds with BUILD=PROFILE in wajic.mk
+// Every instrumented function records an enter and an exit event into a ring buffer in linear memory which gets
+// copied out to JavaScript when it is full. The recorded profile can be turned into folded stacks and a
+// Chrome trace (which can be opened with speedscope) with wajicprof.js.
+// Events are 8 bytes: the function table index (with the highest bit set for exit events) and a time in 100 ns ticks.
+// WebAssembly has no clock so reading the time is a call to JavaScript which costs more than the rest of the hook (around
+// 90 ns against 2 ns per event in V8). Only every WA_PROFILE_CLOCK_INTERVAL-th event reads the time, the events in between
+// get their time spread evenly when the buffer is copied out. A smaller interval gives more exact times for short functions.
+// Under Node.js the profile is written on exit to WA.profileFile, $WA_PROFILE_FILE or profile.wprof.
+// In the browser it can be retrieved with WA.profileData() (as an Uint8Array) or downloaded with WA.profileSave().
+
+#pragma once
+
+#include <wajic.h>
+
+#if defined(WA_PROFILE_IMPLEMENTATION) && !defined(WA_PROFILE)
+#define WA_PROFILE
+#endif
+
+#ifdef WA_PROFILE
+// Pause (0) or resume (1) recording events, can be used to profile only a specific part of the program
+WA_EXTERN void WaProfileEnable(int enable);
+
+// Copy all events recorded so far out to JavaScript
+WA_EXTERN void WaProfileFlush(void);
+#else
+#define WaProfileEnable(enable) ((void)0)
+#define WaProfileFlush() ((void)0)
+#endif
+
+#ifdef WA_PROFILE_IMPLEMENTATION
+
+// Number of events stored in linear memory before they get copied out (128 kb)
+#ifndef WA_PROFILE_RING_EVENTS
+#define WA_PROFILE_RING_EVENTS 16384
+#endif
+
+// Number of events per time stamp read from JavaScript (1 to read the time for every event)
+#ifndef WA_PROFILE_CLOCK_INTERVAL
+#define WA_PROFILE_CLOCK_INTERVAL 16
+#endif
+
+WAJIC_LIB_WITH_INIT(PROFILE,
+(
+	var PRring, PRinterval, PRchunks = [], PRcount = 0;
+	var PRnow = (typeof performance != 'undefined' ? () => performance.now() : () => Date.now()), PRstart = PRnow();
+	var PRtick = () => ((PRnow() - PRstart) * 1e4) >>> 0;
+
+	// Move the events from the ring buffer in linear memory to a list of chunks
+	// Only every PRinterval-th event has a time, the others get a time between the surrounding ones (the last ones up to now)
+	var PRdrain = function()
+	{
+		if (!PRring) return;
+		var ring = PRring>>2, n = MU32[ring], now = PRtick();
+		if (!n) return;
+		var ev = MU32.slice(ring + 3, ring + 3 + n * 2);
+		for (var i = 0; i < n; i += PRinterval)
+		{
+			var j = Math.min(i + PRinterval, n), t = ev[i*2+1], d = ((j < n ? ev[j*2+1] : now) - t) >>> 0;
+			for (var k = i + 1; k < j; k++) ev[k*2+1] = (t + d * (k - i) / (j - i)) >>> 0;
+		}
+		PRchunks.push(ev);
+		PRcount += n;
+		MU32[ring] = 0;
+	};
+
+	// Get the profile file data (magic 'WPRF', version 1, nanoseconds per tick, followed by the events)
+	WA.profileData = function()
+	{
+		PRdrain();
+		var res = new Uint32Array(3 + PRcount * 2), i = 3;
+		res[0] = 0x46525057;
+		res[1] = 1;
+		res[2] = 100;
+		PRchunks.forEach(c => { res.set(c, i); i += c.length; });
+		return new Uint8Array(res.buffer);
+	};
+
+	WA.profileSave = function(name)
+	{
+		var a = document.createElement('a');
+		a.href = URL.createObjectURL(new Blob([WA.profileData()]));
+		a.download = name || 'profile.wprof';
+		a.click();
+	};
+
+	if ((typeof process)[0]=='o') process.on('exit', function()
+	{
+		var path = WA.profileFile || process.env.WA_PROFILE_FILE || 'profile.wprof', data = WA.profileData();
+		require('fs').writeFileSync(path, data);
+		WA.print('Wrote ' + PRcount + ' profile events to ' + path + '\n');
+	});
+),
+void, WaProfile_Start, (void* ring, unsigned int clock_interval),
+{
+	PRring = ring;
+	PRinterval = clock_interval;
+})
+
+// Returns the time since startup in 100 nanosecond ticks (wraps around after 429 seconds)
+WAJIC_LIB(PROFILE, unsigned int, WaProfile_Now, (),
+{
+	return PRtick();
+})
+
+WAJIC_LIB(PROFILE, void, WaProfile_Drain, (),
+{
+	PRdrain();
+})
+
+static struct { unsigned int count, disabled, started, events[WA_PROFILE_RING_EVENTS * 2]; } WaProfile_Ring;
+
+__attribute__((no_instrument_function)) static void WaProfile_Record(unsigned int id)
+{
+	unsigned int n = WaProfile_Ring.count;
+	if (WaProfile_Ring.disabled) return;
+	if (!WaProfile_Ring.started) { WaProfile_Ring.started = 1; WaProfile_Start(&WaProfile_Ring, WA_PROFILE_CLOCK_INTERVAL); }
+	if (n == WA_PROFILE_RING_EVENTS) { WaProfile_Drain(); n = 0; }
+	WaProfile_Ring.events[n * 2] = id;
+	if (n % WA_PROFILE_CLOCK_INTERVAL == 0) WaProfile_Ring.events[n * 2 + 1] = WaProfile_Now();
+	WaProfile_Ring.count = n + 1;
+}
+
+// Hooks inserted by the compiler at the start and end of every function, this_fn is the function table index
+WA_EXTERN __attribute__((no_instrument_function)) void __cyg_profile_func_enter(void* this_fn, void* call_site)
+{
+	WaProfile_Record((unsigned int)this_fn);
+}
+
+WA_EXTERN __attribute__((no_instrument_function)) void __cyg_profile_func_exit(void* this_fn, void* call_site)
+{
+	WaProfile_Record((unsigned int)this_fn | 0x80000000);
+}
+
+// The call_site argument of the hooks is lowered to this on the emscripten target, it is unused so avoid a JavaScript import
+WA_EXTERN __attribute__((no_instrument_function)) void* emscripten_return_address(int level)
+{
+	return 0;
+}
+
+WA_EXTERN __attribute__((no_instrument_function)) void WaProfileEnable(int enable)
+{
+	WaProfile_Ring.disabled = !enable;
+}
+
+WA_EXTERN __attribute__((no_instrument_function)) void WaProfileFlush(void)
+{
+	if (WaProfile_Ring.started) WaProfile_Drain();
+}
+
+#endif //WA_PROFILE_IMPLEMENTATION
@@ -0,0 +1,245 @@
+/*
+  WAjicProf - WebAssembly JavaScript Interface Creator Profile Tool
+  Copyright (C) 2020 Bernhard Schelling
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+'use strict';
+
+function ABORT(msg, e)
+{
+	if (e && typeof e == 'string') msg += "\n" + e;
+	if (e && typeof e == 'object') msg += "\n" + (e.name||'') + (e.message ? ' - ' + e.message : '');
+	console.error('');
+	console.error('[ERROR]');
+	console.error(msg)
+	console.error('');
+	console.error('aborting');
+	console.error('');
+	throw process.exit(1);
+}
+
+(function()
+{
+	var args = process.argv.slice(2);
+
+	function ArgErr(err)
+	{
+		console.error('');
+		console.error('WAjicProf - WebAssembly JavaScript Interface Creator Profile Tool');
+		console.error('');
+		console.error('Error:');
+		console.error(err);
+		console.error('');
+		console.error('For help, run: ' + process.argv[0] + ' ' + process.argv[1] + ' -h');
+		console.error('');
+		throw process.exit(1);
+	}
+
+	function ShowHelp()
+	{
+		console.error('');
+		console.error('WAjicProf - WebAssembly JavaScript Interface Creator Profile Tool');
+		console.error('');
+		console.error('Usage wajicprof.js [<switches>...] <wasm_file> <profile_file>');
+		console.error('');
+		console.error('<wasm_file> must be the .wasm file the profile was recorded with (built with BUILD=PROFILE)');
+		console.error('<profile_file> is a .wprof file written by a program using wajic_profile.h');
+		console.error('');
+		console.error('<switches>');
+		console.error('  -folded P: Write folded stacks with self time in nanoseconds to path P (for flamegraph.pl or speedscope)');
+		console.error('  -trace P:  Write Chrome trace event JSON to path P (for chrome://tracing, Perfetto or speedscope)');
+		console.error('  -top N:    Number of functions listed in the summary (default 20, 0 to disable)');
+		console.error('  -h:        Show this help');
+		console.error('');
+		throw process.exit(0);
+	}
+
+	var fs = require('fs'), wasmPath, profPath, foldedPath, tracePath, top = 20;
+	for (var i = 0; i != args.length; i++)
+	{
+		var arg = args[i];
+		if (arg[0] == '-')
+		{
+			var cmd = arg.replace(/^-+/, '').toLowerCase();
+			if (cmd == 'h' || cmd == 'help') ShowHelp();
+			else if (cmd == 'folded') { if (!(foldedPath = args[++i])) ArgErr('Missing path after -folded'); }
+			else if (cmd == 'trace')  { if (!(tracePath  = args[++i])) ArgErr('Missing path after -trace'); }
+			else if (cmd == 'top')    { if (isNaN(top = parseInt(args[++i]))) ArgErr('Missing number after -top'); }
+			else ArgErr('Invalid argument: ' + arg);
+		}
+		else if (!wasmPath) wasmPath = arg;
+		else if (!profPath) profPath = arg;
+		else ArgErr('Invalid argument: ' + arg);
+	}
+	if (!wasmPath || !profPath) ArgErr('Missing input files');
+
+	function Load(path)
+	{
+		try { var buf = fs.readFileSync(path); } catch (e) { return ABORT('Failed to load file: ' + path, e); }
+		return new Uint8Array(buf);
+	}
+
+	var names = WasmGetTableNames(Load(wasmPath)), prof = Load(profPath);
+	if (prof.length < 12 || (prof.length & 7) != 4) ABORT('Invalid profile file ' + profPath);
+	var events = new Uint32Array(prof.slice().buffer);
+	if (events[0] != 0x46525057 || events[1] != 1) ABORT('Invalid profile file ' + profPath + ' (bad header or version)');
+
+	var res = ProcessEvents(events, names);
+	console.log('  [PROFILE] ' + res.count + ' events, ' + res.funcs.length + ' functions, ' + (res.end / 1e6).toFixed(3) + ' ms' + (res.unmatched ? ', ' + res.unmatched + ' unmatched exit events' : ''));
+
+	if (top)
+	{
+		var list = res.funcs.slice().sort((a, b) => b.self - a.self).slice(0, top), pad = (s, n) => (' '.repeat(n) + s).slice(-n);
+		console.log('');
+		console.log('      Self ms  Self %    Total ms      Calls  Function');
+		list.forEach(f => console.log(pad((f.self / 1e6).toFixed(3), 13) + pad((res.end ? f.self * 100 / res.end : 0).toFixed(1), 8) + pad((f.total / 1e6).toFixed(3), 12) + pad(f.calls, 11) + '  ' + f.name));
+		console.log('');
+	}
+
+	if (foldedPath)
+	{
+		var folded = '';
+		for (var stack in res.folded) folded += stack + ' ' + Math.round(res.folded[stack]) + "\n";
+		fs.writeFileSync(foldedPath, folded);
+		console.log('  [SAVED] ' + foldedPath + ' (' + folded.length + ' bytes)');
+	}
+
+	if (tracePath)
+	{
+		// Build the JSON in parts because traces can have millions of events
+		var parts = [], trace = res.trace;
+		for (var i = 0; i != trace.length; i += 2)
+			parts.push('{"name":' + JSON.stringify(res.funcs[trace[i]>>>1].name) + ',"ph":"' + (trace[i]&1 ? 'E' : 'B') + '","ts":' + (trace[i+1] / 1e3) + ',"pid":1,"tid":1}');
+		var json = '{"displayTimeUnit":"ms","traceEvents":[\n' + parts.join(",\n") + "\n]}\n";
+		fs.writeFileSync(tracePath, json);
+		console.log('  [SAVED] ' + tracePath + ' (' + json.length + ' bytes)');
+	}
+})();
+
+// Rebuild the call stacks from the enter/exit events and sum up self and total time (in nanoseconds) per function and per stack
+function ProcessEvents(events, names)
+{
+	var tickNs = events[2], funcs = [], funcMap = {}, folded = {}, trace = [], stack = [], count = (events.length - 3) >> 1;
+	var unmatched = 0, last = events[4], time = 0;
+
+	function Func(id)
+	{
+		var f = funcMap[id];
+		if (f === undefined)
+		{
+			f = funcMap[id] = funcs.length;
+			funcs.push({ name: (names[id] || 'table[' + id + ']'), self: 0, total: 0, calls: 0, active: 0 });
+		}
+		return f;
+	}
+
+	// Leave the function on top of the stack
+	function Pop(t)
+	{
+		var top = stack.pop(), f = funcs[top.f], path = stack.map(s => funcs[s.f].name).concat(f.name).join(';');
+		f.self += t - top.t - top.child;
+		if (!--f.active) f.total += t - top.t;
+		if (stack.length) stack[stack.length - 1].child += t - top.t;
+		folded[path] = (folded[path] || 0) + t - top.t - top.child;
+		trace.push(top.f << 1 | 1, t);
+	}
+
+	for (var i = 3; i < events.length; i += 2)
+	{
+		// Timestamps are 32-bit and wrap around, assume time always moves forward
+		var id = events[i], raw = events[i + 1];
+		time += ((raw - last) >>> 0) * tickNs;
+		last = raw;
+
+		if (id & 0x80000000)
+		{
+			var f = Func(id & 0x7FFFFFFF), n = stack.length;
+			while (n && stack[n - 1].f != f) n--;
+			if (!n) { unmatched++; continue; } // exit without enter (i.e. recording was enabled in a function)
+			while (stack.length >= n) Pop(time);
+		}
+		else
+		{
+			var f = Func(id);
+			funcs[f].calls++;
+			funcs[f].active++;
+			stack.push({ f: f, t: time, child: 0 });
+			trace.push(f << 1, time);
+		}
+	}
+
+	// Close the functions that were still running when the profile was written (i.e. main loop or exit)
+	while (stack.length) Pop(time);
+
+	return { count: count, funcs: funcs, folded: folded, trace: trace, unmatched: unmatched, end: time };
+}
+
+// Get the function names from the name section mapped by function table index (function pointer values)
+function WasmGetTableNames(wasm)
+{
+	function Get() { for (var b, r, x = 0; r |= ((b = wasm[i++])&127)<<x, b>>7; x += 7); return r; }
+	function GetS() { for (var b, r = 0, x = 0; r |= ((b = wasm[i++])&127)<<x, x += 7, b>>7;); return (x < 32 && (b & 64) ? r | (-1 << x) : r); }
+	function GetString() { var n = Get(), r = Buffer.from(wasm.subarray(i, i + n)).toString(); i += n; return r; }
+	function GetLimits() { if (Get() & 1) Get(); Get(); }
+	function GetOffset() { var op = wasm[i++], r = GetS(); if (op != 0x41 || wasm[i++] != 0x0B) ABORT('Unsupported element segment offset expression'); return r; }
+
+	if (wasm[0] != 0 || wasm[1] != 0x61 || wasm[2] != 0x73 || wasm[3] != 0x6D) ABORT('Input file is not a wasm file');
+	var funcImports = 0, tableFuncs = {}, funcNames = {}, res = {};
+	for (var i = 8, iSectionEnd; i < wasm.length; i = iSectionEnd)
+	{
+		var type = Get(), len = Get();
+		iSectionEnd = i + len;
+		if (type == 2) // import section, count imported functions which come first in the function index space
+		{
+			for (var n = Get(); n--;)
+			{
+				GetString(); GetString();
+				var kind = wasm[i++];
+				if      (kind == 0) { Get(); funcImports++; }
+				else if (kind == 1) { i++; GetLimits(); }
+				else if (kind == 2) { GetLimits(); }
+				else if (kind == 3) { i += 2; }
+			}
+		}
+		else if (type == 9) // element section, map table index to function index
+		{
+			for (var n = Get(); n--;)
+			{
+				var flags = Get();
+				if (flags != 0 && flags != 2) ABORT('Unsupported element segment type ' + flags);
+				if (flags == 2) Get();
+				var offset = GetOffset();
+				if (flags == 2 && wasm[i++] != 0) ABORT('Unsupported element segment kind');
+				for (var m = Get(), j = 0; j != m; j++) tableFuncs[offset + j] = Get();
+			}
+		}
+		else if (type == 0 && GetString() == 'name') // function names subsection of the name section
+		{
+			while (i < iSectionEnd)
+			{
+				var subType = wasm[i++], subEnd = Get(); subEnd += i;
+				if (subType == 1) for (var n = Get(); n--;) { var idx = Get(); funcNames[idx] = GetString(); }
+				i = subEnd;
+			}
+		}
+	}
+	if (!Object.keys(funcNames).length) console.warn('[WARNING] The wasm file has no name section, functions are shown by index (build with BUILD=PROFILE to keep names)');
+	for (var idx in tableFuncs) res[idx] = funcNames[tableFuncs[idx]] || ('func' + tableFuncs[idx] + (tableFuncs[idx] < funcImports ? ' (import)' : ''));
+	return res;
+}
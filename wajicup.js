@@ -27,7 +27,8 @@
 
 'use strict';
 
-var terser, verbose = false;
+// Run as command line tool when started with node (not when loaded with require or in the browser)
+var terser, verbose = false, isCli = (typeof process === 'object' && typeof module === 'object' && require.main === module);
 
 var VERBOSE = function(msg)
 {
@@ -54,7 +55,7 @@ function ABORT(msg, e, code)
 			if (i == e.line && e.col) msg += "\n" + ' '.repeat(errcol + (col ? 10 - col : 7)) + '^';
 		}
 	}
-	if (typeof process !== 'object') throw msg; //throw if not CLI with node
+	if (!isCli) throw msg; //throw if not CLI with node (in the browser, when used as a library or while watching)
 	console.error('');
 	console.error('[ERROR]');
 	console.error(msg)
@@ -65,7 +66,7 @@ function ABORT(msg, e, code)
 }
 
 // Execute CLI if running with node
-if (typeof process === 'object') (function()
+if (isCli) (function()
 {
 	var args = process.argv.slice(2);
 
@@ -110,17 +111,25 @@ if (typeof process === 'object') (function()
 		console.error('  -no_log:     Remove all output logging');
 		console.error('  -streaming:  Enable WASM streaming (needs web server support, new browser)');
 		console.error('  -rle:        Use RLE compression when embedding the WASM file');
-		console.error('  -loadbar:    Add a loading progress bar to the generated HTML');
+		console.error('  -base64:     Embed the WASM file as base64 which gets decoded natively if supported');
+		console.error('  -compressdata: Compress large data segments into a custom section that gets restored into memory at startup');
+		console.error('  -loadbar:    Add a loading progress bar to the generated HTML (with streaming compilation of a separate .wasm file)');
 		console.error('  -node:       Output JavaScript that runs in Node.js (CLI)');
 		console.error('  -embed N P:  Embed data file at path P with name N');
 		console.error('  -gzipreport: Report the output size after gzip compression');
+		console.error('  -timing:     Record the duration of the startup phases in WA.timing');
+		console.error('  -sizereport P: Print the largest contributors to the output size and write a JSON size report to path P');
+		console.error('  -symbolmap P:  Function names for the size report (lines of index:name) if the wasm has no name section');
+		console.error('  -allocator A: Memory allocator when compiling C files (emmalloc or slab)');
+		console.error('  -lto M:      Link-time optimization with the system library when compiling C files (full or thin)');
+		console.error('  -watch:      Keep running and rebuild when an input file changes');
 		console.error('  -v:          Be verbose about processed functions');
 		console.error('  -h:          Show this help');
 		console.error('');
 		throw process.exit(0);
 	}
 
-	var fs = require('fs'), saveCount = 0, saveTotal = 0, gzipTotal = 0, gzipReport = false;
+	var fs = require('fs'), saveCount = 0, saveTotal = 0, gzipTotal = 0, gzipReport = false, sizeReport, symbolMap;
 
 	function Load(path)
 	{
@@ -152,7 +161,7 @@ if (typeof process === 'object') (function()
 		return (dir ? dir.replace(/\\/g, '/') + '/' : '') + (isDirectory ? (dir ? '' : './') : (path.basename(trgPath)));
 	}
 
-	var p = { minify: true, log: true, embeds: {} }, inBytes, cfiles = [], cc = '', ld = '', outWasmPath, outJsPath, outHtmlPath;
+	var p = { minify: true, log: true, embeds: {} }, inBytes, inPath, embedPaths = {}, cfiles = [], cc = '', ld = '', outWasmPath, outJsPath, outHtmlPath, watch;
 	for (var i = 0; i != args.length;)
 	{
 		var arg = args[i++];
@@ -161,13 +170,21 @@ if (typeof process === 'object') (function()
 		if (arg.match(/^-?\/?no_?-?log$/i))    { p.log       = false; continue; }
 		if (arg.match(/^-?\/?streaming$/i))    { p.streaming = true;  continue; }
 		if (arg.match(/^-?\/?rle$/i))          { p.rle       = true;  continue; }
+		if (arg.match(/^-?\/?base64$/i))       { p.base64    = true;  continue; }
+		if (arg.match(/^-?\/?compressdata$/i)) { p.compressdata = true; continue; }
 		if (arg.match(/^-?\/?loadbar$/i))      { p.loadbar   = true;  continue; }
 		if (arg.match(/^-?\/?node$/i))         { p.node      = true;  continue; }
 		if (arg.match(/^-?\/?gzipreport$/i))   { gzipReport  = true;  continue; }
+		if (arg.match(/^-?\/?timing$/i))       { p.timing    = true;  continue; }
+		if (arg.match(/^-?\/?sizereport$/i))   { sizeReport  = args[i++]; continue; }
+		if (arg.match(/^-?\/?symbolmap$/i))    { symbolMap   = args[i++]; continue; }
 		if (arg.match(/^-?\/?(v|verbose)$/i))  { verbose     = true;  continue; }
-		if (arg.match(/^-?\/?embed$/i))        { p.embeds[args[i]] = Load(args[i+1]); i += 2; continue; }
+		if (arg.match(/^-?\/?embed$/i))        { p.embeds[args[i]] = Load(embedPaths[args[i]] = args[i+1]); i += 2; continue; }
 		if (arg.match(/^-?\/?cc$/i))           { cc += ' '+args[i++]; continue; }
 		if (arg.match(/^-?\/?ld$/i))           { ld += ' '+args[i++]; continue; }
+		if (arg.match(/^-?\/?allocator$/i))    { p.allocator = args[i++]; continue; }
+		if (arg.match(/^-?\/?lto$/i))          { p.lto       = args[i++]; continue; }
+		if (arg.match(/^-?\/?watch$/i))        { watch       = true;  continue; }
 		if (arg.match(/^-/)) return ArgErr('Invalid argument: ' + arg);
 
 		var path = arg.match(/^.*\.(wasm|js|html|c|cpp|cc|cxx?)$/i), ext = (path && path[1][0].toUpperCase());
@@ -177,7 +194,7 @@ if (typeof process === 'object') (function()
 		}
 		else if (!inBytes && cfiles.length == 0)
 		{
-			if (ext == 'W' || ext == 'J') inBytes = Load(arg);
+			if (ext == 'W' || ext == 'J') inBytes = Load(inPath = arg);
 			else return ArgErr('Invalid input file: ' + arg + "\n" + 'Must be a file ending with .wasm');
 		}
 		else
@@ -189,52 +206,146 @@ if (typeof process === 'object') (function()
 		}
 	}
 
+	// Calculate relative paths (HTML -> JS -> WASM)
+	p.wasmPath = (outWasmPath ? (outHtmlPath || outJsPath ? PathRelatedTo(outHtmlPath || outJsPath, outWasmPath) : outWasmPath) : undefined);
+	p.jsPath   = (outJsPath   ? (outHtmlPath              ? PathRelatedTo(outHtmlPath,                outJsPath) :   outJsPath) : undefined);
+	p.htmlPath = outHtmlPath;
+
 	// Validate options
 	if (!inBytes && !cfiles.length) return ArgErr('Missing input file and output file(s)');
-	if (!outWasmPath && !outJsPath && !outHtmlPath) return ArgErr('Missing output file(s)');
-	if (cfiles.length || IsWasmFile(inBytes))
-	{
-		if ( outWasmPath && p.streaming) return ArgErr('When outputting just a .wasm file, option -streaming is invalid');
-		if ( outWasmPath && p.node)      return ArgErr('When outputting just a .wasm file, option -node is invalid');
-		if ( outWasmPath && p.rle)       return ArgErr('When outputting a .wasm file, option -rle is invalid');
-		if (!outWasmPath && p.streaming) return ArgErr('When embedding the .wasm file, option -streaming is invalid');
-		if ( outHtmlPath && p.node)      return ArgErr('When generating the .html file, option -node is invalid');
-		if (!outHtmlPath && p.loadbar)   return ArgErr('When not generating the .html file, option -loadbar is invalid');
-		if (!outJsPath && !outWasmPath && p.loadbar) return ArgErr('With just a single output file, option -loadbar is invalid');
+	if (p.allocator && !cfiles.length) return ArgErr('Option -allocator is only valid when compiling C files');
+	if (p.allocator && p.allocator != 'emmalloc' && p.allocator != 'slab') return ArgErr('Invalid allocator: ' + p.allocator + "\n" + 'Must be emmalloc or slab');
+	if (p.lto && !cfiles.length) return ArgErr('Option -lto is only valid when compiling C files');
+	if (p.lto && p.lto != 'full' && p.lto != 'thin') return ArgErr('Invalid LTO mode: ' + p.lto + "\n" + 'Must be full or thin');
+	var err = CheckOptions(p, cfiles.length || IsWasmFile(inBytes));
+	if (err) return ArgErr(err);
+	if (sizeReport && !cfiles.length && !IsWasmFile(inBytes)) return ArgErr('When processing a .js file, option -sizereport is invalid');
+
+	function Build(p)
+	{
+		// Experimental compile C files to WASM directly
+		if (cfiles.length)
+		{
+			const pathToWajic = PathRelatedTo(process.cwd(), __dirname, true), pathToSystem = pathToWajic + 'system/';
+			inBytes = ExperimentalCompileWasm(p, outWasmPath, cfiles, cc, ld, pathToWajic, pathToSystem);
+		}
+
+		var [wasmOut, jsOut, htmlOut] = ProcessFile(inBytes, p);
+		if (wasmOut) Save(outWasmPath, wasmOut);
+		if (jsOut)   Save(outJsPath,   jsOut);
+		if (htmlOut) Save(outHtmlPath, htmlOut);
+		console.log('  [SAVED] ' + saveCount + ' file' + (saveCount != 1 ? 's' : '') + ' (' + saveTotal+ ' bytes)' + (gzipTotal ? ' (' +  gzipTotal + ' gzipped)' : ''));
+
+		if (sizeReport)
+		{
+			var symbols = {};
+			if (symbolMap) ReadUTF8String(Load(symbolMap)).split(/\r?\n/).forEach(l => { var m = l.match(/^(\d+):(.*)$/); if (m) symbols[m[1]] = m[2]; });
+			var report = SizeReport(inBytes, wasmOut, jsOut || htmlOut, symbols, p);
+			if (!symbolMap && !report.named) WARN('The wasm file has no name section, functions are listed by index (build without -strip-all or pass -symbolmap)');
+			Save(sizeReport, WriteUTF8String(JSON.stringify(report, null, 1)));
+		}
 	}
-	else
+
+	if (!watch) return Build(p);
+
+	// Keep running and rebuild when an input file changes, terser and the JIT compiled code stay loaded between builds
+	// Errors get printed but don't end the process (ABORT throws instead of exiting while not in CLI mode)
+	var files = [ inPath, symbolMap ].concat(cfiles, Object.values(embedPaths)).filter(f => f), timer;
+	var Rebuild = function(first)
 	{
-		if (!outJsPath || outWasmPath || outHtmlPath) return ArgErr('When minifying a JS file, only one output file ending with .js is supported');
-		if (!p.minify)   return ArgErr('When processing a .js file, minify must be enabled');
-		if (p.streaming) return ArgErr('When processing a .js file, option -streaming is invalid');
-		if (p.rle)       return ArgErr('When processing a .js file, option -rle is invalid');
-		if (p.embeds && Object.keys(p.embeds).length) return ArgErr('When processing a .js file, option -embed is invalid');
-	}
+		var start = Date.now();
+		saveCount = saveTotal = gzipTotal = 0;
+		isCli = false;
+		try
+		{
+			if (!first)
+			{
+				if (inPath) inBytes = Load(inPath);
+				for (var name in embedPaths) p.embeds[name] = Load(embedPaths[name]);
+			}
+			Build(Object.assign({}, p, { embeds: Object.assign({}, p.embeds) }));
+			console.log('  [WATCH] Built in ' + (Date.now() - start) + ' ms');
+		}
+		catch (e) { console.error('[ERROR]' + "\n" + (e && e.stack || e)); }
+		isCli = true;
+		console.log('  [WATCH] Waiting for changes of ' + files.join(', ') + ' (press Ctrl+C to stop)');
+	};
+	Rebuild(true);
+	process.on('SIGINT', () => process.exit(130)); // run the exit handlers (which delete temporary files) when stopped with Ctrl+C
+	files.forEach(f => fs.watchFile(f, { interval: 250 }, (cur, prev) =>
+	{
+		// Wait for a short moment because build tools can write the file in multiple steps
+		if (cur.mtimeMs == prev.mtimeMs) return;
+		clearTimeout(timer);
+		timer = setTimeout(Rebuild, 100);
+	}));
+})();
+
+// Programmatic interface when loaded with require('wajicup.js') which avoids starting a process and parsing terser for every file
+// All buffers are Uint8Array (or Buffer) objects, options are the same as the command line switches and outputs are passed by name:
+//   { wasmPath, jsPath, htmlPath, minify, log, streaming, rle, base64, compressdata, loadbar, node, timing, embeds: { name: buffer } }
+// The output paths select which outputs get generated and are used to reference the .wasm file from the .js file and both from the .html file
+if (typeof module === 'object' && module.exports) module.exports =
+{
+	// Process an unprocessed .wasm file (or minify a .js file) and return the outputs as { wasm, js, html } (null for outputs not requested)
+	ProcessFile: function(inBytes, options)
+	{
+		var p = Object.assign({ minify: true, log: true, embeds: {} }, options), err = CheckOptions(p, IsWasmFile(inBytes));
+		if (err) throw err;
+		var [wasm, js, html] = ProcessFile(inBytes, p);
+		return { wasm: wasm || null, js: js || null, html: html || null };
+	},
 
-	// Experimental compile C files to WASM directly
-	if (cfiles.length)
+	// Compile and link C/C++ files with the clang and wasm-ld executables next to wajicup.js and return the .wasm file contents
+	// The options can contain cc and ld (additional arguments), allocator and lto. Pass the same options to ProcessFile afterwards to run wasm-opt.
+	CompileFiles: function(cfiles, options)
 	{
-		const pathToWajic = PathRelatedTo(process.cwd(), __dirname, true), pathToSystem = pathToWajic + 'system/';
-		inBytes = ExperimentalCompileWasm(p, outWasmPath, cfiles, cc, ld, pathToWajic, pathToSystem);
-	}
+		const pathToWajic = require('path').join(__dirname, '/'), pathToSystem = pathToWajic + 'system/';
+		return ExperimentalCompileWasm(options, null, cfiles, ' ' + (options.cc || ''), ' ' + (options.ld || ''), pathToWajic, pathToSystem);
+	},
 
-	// Calculate relative paths (HTML -> JS -> WASM)
-	p.wasmPath = (outWasmPath ? (outHtmlPath || outJsPath ? PathRelatedTo(outHtmlPath || outJsPath, outWasmPath) : outWasmPath) : undefined);
-	p.jsPath   = (outJsPath   ? (outHtmlPath              ? PathRelatedTo(outHtmlPath,                outJsPath) :   outJsPath) : undefined);
-	p.htmlPath = outHtmlPath;
+	// Embed files into a .wasm file (like -embed), returns the new .wasm file contents
+	EmbedFiles: function(wasm, embeds)
+	{
+		return WasmEmbedFiles(wasm, embeds);
+	},
+};
 
-	var [wasmOut, jsOut, htmlOut] = ProcessFile(inBytes, p);
-	if (wasmOut) Save(outWasmPath, wasmOut);
-	if (jsOut)   Save(outJsPath,   jsOut);
-	if (htmlOut) Save(outHtmlPath, htmlOut);
-	console.log('  [SAVED] ' + saveCount + ' file' + (saveCount != 1 ? 's' : '') + ' (' + saveTotal+ ' bytes)' + (gzipTotal ? ' (' +  gzipTotal + ' gzipped)' : ''));
-})();
+// Check the combination of output files and options, returns an error message if they are invalid
+function CheckOptions(p, wasmInput)
+{
+	if (!p.wasmPath && !p.jsPath && !p.htmlPath) return 'Missing output file(s)';
+	if (wasmInput)
+	{
+		if ( p.wasmPath && p.streaming) return 'When outputting just a .wasm file, option -streaming is invalid';
+		if ( p.wasmPath && !p.jsPath && p.node) return 'When outputting just a .wasm file, option -node is invalid';
+		if ( p.wasmPath && p.rle)       return 'When outputting a .wasm file, option -rle is invalid';
+		if ( p.wasmPath && p.base64)    return 'When outputting a .wasm file, option -base64 is invalid';
+		if ( p.rle && p.base64)         return 'Options -rle and -base64 cannot be combined';
+		if (!p.wasmPath && p.streaming) return 'When embedding the .wasm file, option -streaming is invalid';
+		if ( p.htmlPath && p.node)      return 'When generating the .html file, option -node is invalid';
+		if ( p.wasmPath && !p.jsPath && !p.htmlPath && p.timing) return 'When outputting just a .wasm file, option -timing is invalid';
+		if (!p.htmlPath && p.loadbar)   return 'When not generating the .html file, option -loadbar is invalid';
+		if (!p.jsPath && !p.wasmPath && p.loadbar) return 'With just a single output file, option -loadbar is invalid';
+	}
+	else
+	{
+		if (!p.jsPath || p.wasmPath || p.htmlPath) return 'When minifying a JS file, only one output file ending with .js is supported';
+		if (!p.minify)   return 'When processing a .js file, minify must be enabled';
+		if (p.streaming) return 'When processing a .js file, option -streaming is invalid';
+		if (p.rle)       return 'When processing a .js file, option -rle is invalid';
+		if (p.base64)    return 'When processing a .js file, option -base64 is invalid';
+		if (p.compressdata) return 'When processing a .js file, option -compressdata is invalid';
+		if (p.timing)    return 'When processing a .js file, option -timing is invalid';
+		if (p.embeds && Object.keys(p.embeds).length) return 'When processing a .js file, option -embed is invalid';
+	}
+}
 
 function ProcessFile(inBytes, p)
 {
 	var minify_compress = { ecma: 2015, passes: 5, unsafe: true, unsafe_arrows: true, unsafe_math: true, drop_console: !p.log, pure_funcs:['document.getElementById'] };
-	var minify_reserved = ['abort', 'MU8', 'MU16', 'MU32', 'MI32', 'MF32', 'STOP', 'TEMP', 'MStrPut', 'MStrGet', 'MArrPut', 'ASM', 'WM', 'J', 'N' ];
-	p.terser = require_terser();
+	var minify_reserved = ['abort', 'MU8', 'MU16', 'MU32', 'MI32', 'MF32', 'STOP', 'TEMP', 'MStrPut', 'MStrGet', 'MArrPut', 'MStrPutTemp', 'MArrPutTemp', 'MView', 'ASM', 'WM', 'J', 'N' ];
+	p.terser = terser || (terser = require_terser());
 	p.terser_options_toplevel = { compress: minify_compress, mangle: { eval: 1, reserved: minify_reserved }, toplevel: true };
 	p.terser_options_reserve = { compress: minify_compress, mangle: { eval: 1, reserved: minify_reserved } };
 	p.terser_options_merge = { compress: minify_compress };
@@ -250,7 +361,7 @@ function ProcessFile(inBytes, p)
 		}
 		else if (p.wasmPath)
 		{
-			return [ WasmEmbedFiles(GenerateWasm(p), p.embeds), null, null ]
+			return [ WasmEmbedFiles(WasmCompressData(GenerateWasm(p), p), p.embeds), null, null ]
 		}
 	}
 	else
@@ -303,38 +414,43 @@ function GenerateHtml(p)
 				         + "	started: () => WA.print('started\\n')," + "\n" : '')
 			+ '};' + "\n"
 			+ "(()=>{" + "\n"
-			+ "var progress = document.getElementById('wa_progress'), progressbar = progress.firstElementChild;" + "\n"
-			+ "var " + (p.jsPath?"xhrj":'')+(both?",":"")+(p.wasmPath?"xhrw":"") + ";" + "\n"
+			+ "var progress = document.getElementById('wa_progress'), progressbar = progress.firstElementChild, downloads = [];" + "\n"
 			+ "var UpdateProgress = function()" + "\n"
 			+ "{" + "\n"
-				+ "	if (!progress) return;" + "\n"
-				+ "	progressbar.style.width = Math.min(("+(p.jsPath?"xhrj.loaded":'')+(both?"+":"")+(p.wasmPath?"xhrw.loaded":"")+")/("+(p.jsPath?"xhrj.total":'')+(both?"+":"")+(p.wasmPath?"xhrw.total":"")+"),1)*100+'%';" + "\n"
+				+ "	var loaded = 0, total = 0, done = 0;" + "\n"
+				+ "	downloads.forEach(d => { loaded += d.loaded; total += d.total; done += d.done; });" + "\n"
+				+ "	if (total) progressbar.style.width = Math.min(loaded/total,1)*100+'%';" + "\n"
+				+ "	if (done == downloads.length) progress.style.display = 'none';" + "\n"
 			+ "};" + "\n"
-			+ "var OnLoaded = function()" + "\n"
+			+ "// Fetch a file and split the response stream, one branch counts the bytes for the progress bar, the other gets used by the loader" + "\n"
+			+ "var Load = function(url, type)" + "\n"
 			+ "{" + "\n"
-				+ "	if (" + (p.jsPath?"xhrj.readyState != 4":'')+(both?" || ":"")+(p.wasmPath?"xhrw.readyState != 4":"") + ") return;" + "\n"
-				+ "	progress.style.display = 'none';" + "\n"
-				+ (p.jsPath ? ''
+				+ "	var d = { loaded: 0, total: 0, done: 0 };" + "\n"
+				+ "	downloads.push(d);" + "\n"
+				+ "	return fetch(url).then(r =>" + "\n"
+				+ "	{" + "\n"
+					+ "		if (!r.ok) throw 'Status: ' + r.status;" + "\n"
+					+ "		if (!r.body || !r.body.tee) { d.done = 1; UpdateProgress(); return r; }" + "\n"
+					+ "		var streams = r.body.tee(), reader = streams[0].getReader();" + "\n"
+					+ "		var Read = () => reader.read().then(c => { if (c.done) d.done = 1; else if (d.total) d.loaded = Math.min(d.loaded + c.value.length, d.total); UpdateProgress(); if (!c.done) Read(); });" + "\n"
+					+ "		// Without a length or with a compressed body (which counts the decompressed bytes) the download doesn't advance the bar" + "\n"
+					+ "		d.total = (r.headers.get('Content-Encoding') ? 0 : +r.headers.get('Content-Length') || 0);" + "\n"
+					+ "		Read();" + "\n"
+					+ "		return new Response(streams[1], { headers: { 'Content-Type': type } });" + "\n"
+				+ "	}).catch(err => { WA.error('DL', 'Error - URL: ' + url + ' - ' + err); throw 'abort'; });" + "\n"
+			+ "};" + "\n"
+			+ (p.wasmPath ? "var wasm = Load('" + p.wasmPath + "', 'application/wasm');" + "\n" : '')
+			+ (p.jsPath ? ''
+				+ "// Run the loader script once it is downloaded (while the wasm file is still downloading and compiling)" + "\n"
+				+ "Load('" + p.jsPath + "', 'text/javascript').then(r => r.text()).then(js =>" + "\n"
+				+ "{" + "\n"
 					+ "	var s = document.createElement('script'), d = document.documentElement;" + "\n"
-					+ "	s.textContent = xhrj.response;" + "\n"
+					+ "	s.textContent = js;" + "\n"
 					+ "	d.appendChild(s);" + "\n"
-					+ "	d.removeChild(s);" + "\n" : '')
-				+ (p.wasmPath ? "	WA.loaded(xhrw.response);" + "\n" : '')
-				+ "	" + (p.jsPath?"xhrj = s = s.textContent = ":'')+(p.wasmPath?"xhrw = ":"") + "null;" + "\n"
-			+ "};" + "\n"
-			+ "var Load = function(url, rt)" + "\n"
-			+ "{" + "\n"
-				+ "	var xhr = new XMLHttpRequest();" + "\n"
-				+ "	xhr.loaded = xhr.total = 0;" + "\n"
-				+ "	xhr.open('GET', url);" + "\n"
-				+ "	xhr.responseType = rt;" + "\n"
-				+ "	xhr.onprogress = function(e) { if (e.lengthComputable) { xhr.loaded = e.loaded; xhr.total = e.total; UpdateProgress(); } };" + "\n"
-				+ "	xhr.onerror = xhr.onabort = function() { WA.error('DL', 'Aborted - URL: ' + url); };" + "\n"
-				+ "	xhr.onload = function() { if (xhr.status != 200) WA.error('DL', 'Error - URL: ' + url + ' - Status: ' + xhr.statusText); else OnLoaded(); };" + "\n"
-				+ "	return xhr;" + "\n"
-			+ "};" + "\n"
-			+ (p.jsPath ? "(xhrj = Load('" + p.jsPath + "', 'text')).send();" + "\n" : '')
-			+ (p.wasmPath ? "(xhrw = Load('" + p.wasmPath + "', 'arraybuffer')).send();" + "\n" : '')
+					+ "	d.removeChild(s);" + "\n"
+					+ (p.wasmPath ? "	WA.loaded(wasm);" + "\n" : '')
+				+ "});" + "\n"
+				: "Promise.resolve().then(() => WA.loaded(wasm));" + "\n")
 			+ "})();" + "\n"
 			+ (p.jsPath ? '' : p.js)
 			+ '</'+'script>' + "\n"
@@ -363,7 +479,10 @@ function FinalizeJs(p)
 	if (p.minify && !p.jsPath && !p.loadbar)
 	{
 		// pre-declare all variables for minification
-		res += 'var WA_'+[ 'maxmem', 'asm', 'wm', 'abort' ].join(',WA_')+';' + "\n"
+		// Also declare the WA properties set by the loader and WAJIC code (which become local variables as well)
+		var props = [ 'maxmem', 'asm', 'wm', 'abort' ], fixed = props.concat('module', 'canvas', 'print', 'error', 'started');
+		(p.js.match(/\bWA\.[A-Za-z_$][\w$]*/g) || []).forEach(m => fixed.includes(m = m.slice(3)) || props.includes(m) || props.push(m));
+		res += 'var WA_'+props.join(',WA_')+';' + "\n"
 				+ 'var WA_module' + (p.wasmPath ? ' = \'' + p.wasmPath + '\'' : '') + ';' + "\n"
 				+ 'var WA_canvas' + (p.use_canvas ? ' = document.getElementById(\'wa_canvas\')' : '') + ';' + "\n"
 				+ 'var WA_print'   + (p.log ? ' = text => document.getElementById(\'wa_log\').innerHTML += text.replace(/\\n/g, \'<br>\')' : ' = t=>{}') + ';' + "\n"
@@ -447,6 +566,13 @@ function GenerateJsAndWasm(p)
 			libNewNames[JSLib][JSName] = newName;
 		});
 
+	for (var JSLib in libs)
+	{
+		if (!libs[JSLib]["INIT\x11"].length) continue;
+		var libCode = Object.keys(libs[JSLib]).filter(n => n != "INIT\x11").map(n => libs[JSLib][n]).join("\n");
+		libs[JSLib]["INIT\x11"] = [ ShakeLibInit(libs[JSLib]["INIT\x11"].join("\n"), libCode, JSLib) ];
+	}
+
 	VERBOSE('    [WASM] WAJIC functions embedded in JS, remove code from WASM');
 	p.wasm = WasmEmbedFiles(WasmReplaceLibImportNames(p.wasm, libNewNames), p.embeds);
 	p.js = GenerateJsBody(mods, libs, import_memory_pages, p);
@@ -461,8 +587,9 @@ function GenerateJsBody(mods, libs, import_memory_pages, p)
 	const memory_pages = Math.max(import_memory_pages, export_memory_pages);
 
 	var imports = GenerateJsImports(mods, libs);
-	const [use_sbrk, use_MStrPut, use_MStrGet, use_MArrPut, use_WM, use_ASM, use_MU8, use_MU16, use_MU32, use_MI32, use_MF32, use_MSetViews, use_MEM, use_TEMP]
+	const [use_sbrk, use_MStrPut, use_MStrGet, use_MArrPut, use_MStrPutTemp, use_MArrPutTemp, use_WM, use_ASM, use_MU8, use_MU16, use_MU32, use_MI32, use_MF32, use_MSetViews, use_MEM, use_TEMP, use_MView]
 		= VerifyWasmLayout(exports, mods, imports, use_memory, p);
+	p.wasm = WasmCompressData(p.wasm, p);
 
 	// Fix up some special cases in the generated imports code
 	if (import_memory_pages && !use_MEM)
@@ -509,6 +636,13 @@ function GenerateJsBody(mods, libs, import_memory_pages, p)
 	body += '	throw \'abort\';' + "\n";
 	body += '};' + "\n\n";
 
+	if (p.timing)
+	{
+		body += '// Startup phase timing, WA.timing.start is the time the loader started and the phases are set to the milliseconds since then' + "\n";
+		body += 'var timeNow = (typeof performance != \'undefined\' ? () => performance.now() : () => Date.now());' + "\n";
+		body += 'var timing = WA.timing = { start: timeNow() }, timeMark = phase => timing[phase] = timeNow() - timing.start;' + "\n\n";
+	}
+
 	if (use_MStrPut)
 	{
 		body += '// Puts a string from JavaScript onto the wasm memory heap (encoded as UTF8)' + "\n";
@@ -546,6 +680,83 @@ function GenerateJsBody(mods, libs, import_memory_pages, p)
 		body += '}' + "\n\n";
 	}
 
+	if (use_MStrPutTemp || use_MArrPutTemp)
+	{
+		body += '// Scratch memory for short-lived strings/arrays passed to wasm which stay valid until control returns to the event loop' + "\n";
+		body += '// (the end of the current WAJIC call, callback or frame) when the scratch memory gets reset without any calls to free' + "\n";
+		body += 'var MTempBuf = 0, MTempSize = 0, MTempUsed = 0, MTempOld = [], MTempQueued, MTempCount = 0, MTempMallocs = 0;' + "\n";
+		body += 'var MTempAlloc = function(len)' + "\n";
+		body += '{' + "\n";
+		body += '	if (!MTempQueued) { MTempQueued = 1; Promise.resolve().then(MTempReset); }' + "\n";
+		body += '	if (MTempUsed + len > MTempSize)' + "\n";
+		body += '	{' + "\n";
+		body += '		// Keep the full buffer alive until the reset as pointers into it might still be in use' + "\n";
+		body += '		if (MTempBuf) MTempOld.push(MTempBuf);' + "\n";
+		body += '		MTempSize = Math.max(MTempSize * 2, len, 65536);' + "\n";
+		body += '		if (!(MTempBuf = ASM.malloc(MTempSize))) return MTempSize = 0;' + "\n";
+		body += '		MTempUsed = 0;' + "\n";
+		body += '		MTempMallocs++;' + "\n";
+		body += '	}' + "\n";
+		body += '	var ptr = MTempBuf + MTempUsed;' + "\n";
+		body += '	MTempUsed += (len + 7) & ~7;' + "\n";
+		body += '	MTempCount++;' + "\n";
+		body += '	return ptr;' + "\n";
+		body += '};' + "\n";
+		body += 'var MTempReset = function()' + "\n";
+		body += '{' + "\n";
+		body += '	MTempOld.forEach(ptr => ASM.free(ptr));' + "\n";
+		body += '	MTempOld = [];' + "\n";
+		body += '	MTempUsed = MTempQueued = 0;' + "\n";
+		body += '	if (MTempSize > 1048576) { ASM.free(MTempBuf); MTempBuf = MTempSize = 0; } // don\'t hold on to memory after large temporaries' + "\n";
+		body += '};' + "\n";
+		body += "\n";
+		body += '// Same as MStrPut(str) and MArrPut(a) but using the scratch memory, the returned pointer must not be freed or kept' + "\n";
+		if (use_MStrPutTemp)
+		{
+			body += 'var MStrPutTemp = function(str)' + "\n";
+			body += '{' + "\n";
+			body += '	var buf = new TextEncoder().encode(str), out = MTempAlloc(buf.length+1);' + "\n";
+			body += '	MU8.set(buf, out);' + "\n";
+			body += '	MU8[out + buf.length] = 0;' + "\n";
+			body += '	return out;' + "\n";
+			body += '};' + "\n";
+		}
+		if (use_MArrPutTemp)
+		{
+			body += 'var MArrPutTemp = function(a)' + "\n";
+			body += '{' + "\n";
+			body += '	var len = a.byteLength || a.length, ptr = len && MTempAlloc(len);' + "\n";
+			body += '	MU8.set(a, ptr);' + "\n";
+			body += '	return ptr;' + "\n";
+			body += '};' + "\n";
+		}
+		body += "\n";
+		body += '// Number of temporaries put into scratch memory and how many calls to malloc that avoided' + "\n";
+		body += 'WA.tempStats = () => ({ temps: MTempCount, mallocs: MTempMallocs, avoided: MTempCount - MTempMallocs });' + "\n\n";
+	}
+
+	if (use_MView)
+	{
+		body += '// Get a view of len elements at index idx of a memory view for the typed array parameters of WAJIC functions (see WA_F32ARRAY)' + "\n";
+		body += '// Views are kept by index on the memory view so calls with the same arrays don\'t allocate, when the memory grows they get dropped' + "\n";
+		body += 'var MViewCount = 0, MViewAllocs = 0;' + "\n";
+		body += 'var MView = function(heap, idx, len)' + "\n";
+		body += '{' + "\n";
+		body += '	if (!idx) return null;' + "\n";
+		body += '	var views = heap.views || (heap.views = new Map()), view = views.get(idx);' + "\n";
+		body += '	MViewCount++;' + "\n";
+		body += '	if (!view || view.length != len)' + "\n";
+		body += '	{' + "\n";
+		body += '		if (views.size >= 1024) views.clear();' + "\n";
+		body += '		views.set(idx, view = heap.subarray(idx, idx + len));' + "\n";
+		body += '		MViewAllocs++;' + "\n";
+		body += '	}' + "\n";
+		body += '	return view;' + "\n";
+		body += '};' + "\n\n";
+		body += '// Number of typed array parameters passed to WAJIC functions and how many of them needed a new view' + "\n";
+		body += 'WA.viewStats = () => ({ views: MViewCount, allocs: MViewAllocs, reused: MViewCount - MViewAllocs });' + "\n\n";
+	}
+
 	if (use_MSetViews)
 	{
 		body += '// Set the array views of various data types used to read/write to the wasm memory from JavaScript' + "\n";
@@ -560,6 +771,30 @@ function GenerateJsBody(mods, libs, import_memory_pages, p)
 		body += '};' + "\n\n";
 	}
 
+	if (p.dataCompressed)
+	{
+		var memory = (export_memory_name ? 'output.instance.exports.' + export_memory_name : 'imports' + Object.keys(mods).map(mod => Object.keys(mods[mod]).filter(fld => mods[mod][fld] == 'MEMORY').map(fld => '[' + JSON.stringify(mod) + '][' + JSON.stringify(fld) + ']').join('')).join(''));
+		body += '// Decompress the data segments that were moved into the custom section \'wajic_data\' and copy them into the wasm memory' + "\n";
+		body += 'var MDataRestore = function(output)' + "\n";
+		body += '{' + "\n";
+		body += '	var sec = new Uint8Array(WebAssembly.Module.customSections(output.module, \'wajic_data\')[0]), i = 0, segs = [];' + "\n";
+		if (p.timing) body += '	timeMark(\'instantiate\');' + "\n";
+		body += '	var Get = () => { for (var b, r = 0, x = 0; r |= ((b = sec[i++])&127)<<x, b>>7; x += 7); return r; };' + "\n";
+		body += '	for (var n = Get(); n--;) segs.push([Get(), Get()]);' + "\n";
+		if (p.node)
+			body += '	return Promise.resolve(require(\'zlib\').inflateSync(sec.subarray(i))).then(data =>' + "\n";
+		else
+			body += '	return new Response(new Response(sec.subarray(i)).body.pipeThrough(new DecompressionStream(\'deflate\'))).arrayBuffer().then(data =>' + "\n";
+		body += '	{' + "\n";
+		body += '		var mem = new Uint8Array(' + memory + '.buffer), pos = 0;' + "\n";
+		body += '		data = new Uint8Array(data);' + "\n";
+		body += '		segs.forEach(s => mem.set(data.subarray(pos, pos += s[1]), s[0]));' + "\n";
+		if (p.timing) body += '		timeMark(\'data\');' + "\n";
+		body += '		return output;' + "\n";
+		body += '	});' + "\n";
+		body += '};' + "\n\n";
+	}
+
 	if (!p.wasmPath)
 	{
 		if (p.rle)
@@ -573,35 +808,64 @@ function GenerateJsBody(mods, libs, import_memory_pages, p)
 			body += '};' + "\n\n";
 
 			body += '// Decompress and decode the embedded .wasm file' + "\n";
-			body += 'var wasm = DecodeRLE85("' + EncodeRLE85(p.wasm) + '");' + "\n\n";
+			body += 'var wasm = DecodeRLE85("' + EncodeRLE85(p.wasm) + '");' + "\n";
+			body += (p.timing ? 'timeMark(\'decode\');' + "\n" : '') + "\n";
+		}
+		else if (p.base64)
+		{
+			body += '// Function to decode a base64 string to a byte array' + (p.node ? '' : ' (natively if supported)') + "\n";
+			body += 'var DecodeBase64 = function(str)' + "\n";
+			body += '{' + "\n";
+			if (p.node)
+			{
+				body += '	return Buffer.from(str, \'base64\');' + "\n";
+			}
+			else
+			{
+				body += '	if (Uint8Array.fromBase64) return Uint8Array.fromBase64(str);' + "\n";
+				body += '	for (var s=atob(str),n=s.length,a=new Uint8Array(n),i=0;i<n;i++) a[i]=s.charCodeAt(i);' + "\n";
+				body += '	return a;' + "\n";
+			}
+			body += '};' + "\n\n";
+
+			body += '// Decode the embedded .wasm file' + "\n";
+			body += 'var wasm = DecodeBase64("' + EncodeBase64(p.wasm) + '");' + "\n";
+			body += (p.timing ? 'timeMark(\'decode\');' + "\n" : '') + "\n";
 		}
 		else
 		{
 			body += '// Function to decode a W64 encoded string to a byte array' + "\n";
 			body += 'var DecodeW64 = function(str)' + "\n";
 			body += '{' + "\n";
-			body += '	var e,n=str.length,r=str[n-1],t=0,o=0,c=Uint8Array,d=new c(128).map((e,n)=>n<92?n-58:n-59);' + "\n";
-			body += '	var a=new c(n/4*3-(r<3&&r)),f=e=>d[str.charCodeAt(t++)]<<e,h=n=>a[o++]=e>>n;' + "\n";
-			body += '	while (t<n) e=f(0)|f(6)|f(12)|f(18),h(0),h(8),h(16);' + "\n";
+			body += '	var s=new TextEncoder().encode(str),n=s.length,r=str[n-1],t=0,o=0,e,c=Uint8Array,d=new c(128).map((e,n)=>n<92?n-58:n-59),a=new c(n/4*3-(r<3&&r));' + "\n";
+			body += '	while (t<n) e=d[s[t++]]|d[s[t++]]<<6|d[s[t++]]<<12|d[s[t++]]<<18,a[o++]=e,a[o++]=e>>8,a[o++]=e>>16;' + "\n";
 			body += '	return a;' + "\n";
 			body += '};' + "\n\n";
 
 			body += '// Decode the embedded .wasm file' + "\n";
-			body += 'var wasm = DecodeW64("' + EncodeW64(p.wasm) + '");' + "\n\n";
+			body += 'var wasm = DecodeW64("' + EncodeW64(p.wasm) + '");' + "\n";
+			body += (p.timing ? 'timeMark(\'decode\');' + "\n" : '') + "\n";
 		}
 	}
 
 	body += imports;
 
-	if (!p.wasmPath || p.loadbar)
+	var restore = (p.dataCompressed ? '.then(MDataRestore)' : '');
+	if (!p.wasmPath)
 	{
 		body += '// Instantiate the wasm module by passing the prepared import functions for the wasm module' + "\n";
-		body += 'WebAssembly.instantiate(wasm, imports).then(output =>' + "\n";
+		body += 'WebAssembly.instantiate(wasm, imports)' + restore + '.then(output =>' + "\n";
+	}
+	else if (p.loadbar)
+	{
+		body += '// Compile the wasm module while it is being downloaded by the progress bar loader (with a fallback for browsers without streaming)' + "\n";
+		body += '(WebAssembly.instantiateStreaming ? WebAssembly.instantiateStreaming(wasm, imports) : wasm.then(r => r.arrayBuffer()).then(r => WebAssembly.instantiate(r, imports)))' + restore + '.then(output =>' + "\n";
 	}
 	else if (p.node)
 	{
 		body += '// Instantiate the wasm module by passing the prepared import functions for the wasm module' + "\n";
-		body += 'WebAssembly.instantiate(require(\'fs\').readFileSync(WA.module), imports).then(output =>' + "\n";
+		if (p.timing) body += 'var wasm = require(\'fs\').readFileSync(WA.module);' + "\n" + 'timeMark(\'read\');' + "\n";
+		body += 'WebAssembly.instantiate(' + (p.timing ? 'wasm' : 'require(\'fs\').readFileSync(WA.module)') + ', imports)' + restore + '.then(output =>' + "\n";
 	}
 	else
 	{
@@ -609,12 +873,12 @@ function GenerateJsBody(mods, libs, import_memory_pages, p)
 		if (p.streaming)
 		{
 			body += '// Stream and instantiate the wasm module by passing the prepared import functions for the wasm module' + "\n";
-			body += 'WebAssembly.instantiateStreaming(fetch(' + src + '), imports).then(output =>' + "\n";
+			body += 'WebAssembly.instantiateStreaming(fetch(' + src + '), imports)' + restore + '.then(output =>' + "\n";
 		}
 		else
 		{
 			body += '// Fetch and instantiate the wasm module by passing the prepared import functions for the wasm module' + "\n";
-			body += 'fetch(' + src + ').then(r => r.arrayBuffer()).then(r => WebAssembly.instantiate(r, imports)).then(output =>' + "\n";
+			body += 'fetch(' + src + ').then(r => r.arrayBuffer()).then(r => ' + (p.timing ? '(timeMark(\'read\'), WebAssembly.instantiate(r, imports))' : 'WebAssembly.instantiate(r, imports)') + ')' + restore + '.then(output =>' + "\n";
 		}
 	}
 
@@ -623,7 +887,8 @@ function GenerateJsBody(mods, libs, import_memory_pages, p)
 	body += '	WA.wm' + (use_WM ? ' = WM' : '') + ' = output.module;' + "\n\n";
 
 	body += '	// Store the list of the functions exported by the wasm module in WA.asm' + "\n";
-	body += '	' + (use_ASM ? 'WA.asm = ASM' : 'var ASM = WA.asm') + ' = output.instance.exports;' + "\n\n";
+	body += '	' + (use_ASM ? 'WA.asm = ASM' : 'var ASM = WA.asm') + ' = output.instance.exports;' + "\n";
+	body += (p.timing && !p.dataCompressed ? '	timeMark(\'instantiate\');' + "\n" : '') + "\n";
 
 	body += '	var started = WA.started;' + "\n\n";
 
@@ -642,6 +907,7 @@ function GenerateJsBody(mods, libs, import_memory_pages, p)
 		body += '	// Call global constructors' + "\n";
 		body += '	ASM.__wasm_call_ctors();' + "\n\n";
 	}
+	if (p.timing) body += '	timeMark(\'ctors\');' + "\n\n";
 	if ((exports.main || exports.__main_argc_argv) && exports.malloc)
 	{
 		body += '	// Allocate 10 bytes of memory to store the argument list with 1 entry to pass to main' + "\n";
@@ -672,6 +938,7 @@ function GenerateJsBody(mods, libs, import_memory_pages, p)
 		body += '	// Call the WajicMain function' + "\n";
 		body += '	ASM.WajicMain();' + "\n\n";
 	}
+	if (p.timing) body += '	timeMark(\'main\');' + "\n\n";
 	body += '	// If the outer HTML file supplied a \'started\' callback, call it' + "\n";
 	body += '	if (started) started();' + "\n";
 	body += '})' + "\n";
@@ -707,6 +974,19 @@ function GenerateJsImports(mods, libs)
 		imports += (added_one ? '' : '{') + '};' + "\n\n";
 	}
 
+	if (Object.keys(mods).some(mod => (mod == 'env' || mod.includes('wasi')) && Object.keys(mods[mod]).some(fld => fld.match(/^clock/))))
+	{
+		imports += '// Get the current time of a clock as [seconds, nanoseconds] (clock id 0 is the realtime clock, all other ids are monotonic)' + "\n";
+		imports += 'var clockGet = function(clk)' + "\n";
+		imports += '{' + "\n";
+		imports += '	if (clk && (typeof process)[0]==\'o\') return process.hrtime();' + "\n";
+		imports += '	var perf = (typeof performance != \'undefined\' && performance), ms = (!perf ? Date.now() : clk ? perf.now() : (perf.timeOrigin || Date.now() - perf.now()) + perf.now());' + "\n";
+		imports += '	return [Math.floor(ms / 1000), Math.floor((ms % 1000) * 1e6)];' + "\n";
+		imports += '}, clockStart = clockGet(1);' + "\n\n";
+		imports += '// Get the resolution of a clock in nanoseconds' + "\n";
+		imports += 'var clockRes = clk => (clk && (typeof process)[0]==\'o\' ? 1 : 1000);' + "\n\n";
+	}
+
 	imports += 'var imports =' + "\n";
 	imports += '{' + "\n";
 	if (has_libs) imports += '	J: J,' + "\n";
@@ -749,6 +1029,21 @@ function GenerateJsImports(mods, libs)
 					imports += '\n		// Function querying the system time' + "\n";
 					imports += '		gettimeofday: function(ptr) { var now = Date.now(); MU32[ptr>>2]=(now/1000)|0; MU32[(ptr+4)>>2]=((now % 1000)*1000)|0; },' + "\n";
 				}
+				else if (fld == 'clock_gettime')
+				{
+					imports += '\n		// Function querying a high resolution clock (CLOCK_REALTIME with sub-millisecond precision, CLOCK_MONOTONIC and CPU time clocks)' + "\n";
+					imports += '		clock_gettime: function(clk, ptr) { var t = clockGet(clk); MU32[ptr>>2] = t[0]; MU32[(ptr+4)>>2] = t[1]; return 0; },' + "\n";
+				}
+				else if (fld == 'clock_getres')
+				{
+					imports += '\n		// Function querying the resolution of a clock' + "\n";
+					imports += '		clock_getres: function(clk, ptr) { if (ptr) { MU32[ptr>>2] = 0; MU32[(ptr+4)>>2] = clockRes(clk); } return 0; },' + "\n";
+				}
+				else if (fld == 'clock')
+				{
+					imports += '\n		// Function querying the processor time in microseconds' + "\n";
+					imports += '		clock: function() { var t = clockGet(1); return ((t[0] - clockStart[0]) * 1e6 + (t[1] - clockStart[1]) / 1e3)|0; },' + "\n";
+				}
 				else if (fld == '__assert_fail')
 				{
 					imports += '\n		// Failed assert will abort the program' + "\n";
@@ -824,6 +1119,17 @@ function GenerateJsImports(mods, libs)
 					imports += '			return 0; // no error' + "\n";
 					imports += '		}' + "\n";
 				}
+				else if (fld == 'clock_time_get' || fld == 'clock_res_get')
+				{
+					imports += '\n		// Clock functions write a 64-bit nanosecond value (64-bit parameters can be split by wasm-opt so the pointer is always the last argument)' + "\n";
+					imports += '		' + fld + ': function(clk)' + "\n";
+					imports += '		{' + "\n";
+					imports += '			var t = ' + (fld == 'clock_res_get' ? '[0, clockRes(clk)]' : 'clockGet(clk)') + ', ns = t[0] * 1e9 + t[1], ptr = arguments[arguments.length - 1];' + "\n";
+					imports += '			MU32[ptr>>2] = ns % 4294967296;' + "\n";
+					imports += '			MU32[(ptr+4)>>2] = ns / 4294967296;' + "\n";
+					imports += '			return 0;' + "\n";
+					imports += '		},' + "\n";
+				}
 				else
 				{
 					imports += '		' + fld + ': () => 0, // IO function not emulated' + "\n";
@@ -861,7 +1167,7 @@ function GenerateWasm(p)
 {
 	VERBOSE('    [WASM] Process - Read #WAJIC functions - File Size: ' + p.wasm.length);
 
-	var mods = {env:{}}, import_memory, libEvals = {};
+	var mods = {env:{}}, import_memory, libEvals = {}, libInits = {};
 	var splitTag = '"!{>}<~"', libREx = new RegExp('(?:;|,|)JSFUNC\\("~(\\w+)~",([^=]+)=>({?.*?}?),'+splitTag+'\\)', 'g'), imports = '';
 	WasmProcessImports(p.wasm, true, 
 		function(mod, fld, isMemory, memInitialPages)
@@ -872,12 +1178,20 @@ function GenerateWasm(p)
 		},
 		function(JSLib, JSName, JSArgs, JSCode, JSInit)
 		{
-			if (!libEvals[JSLib]) libEvals[JSLib] = '';
-			if (JSInit) libEvals[JSLib] = JSInit + libEvals[JSLib];
+			if (!libEvals[JSLib]) { libEvals[JSLib] = ''; libInits[JSLib] = ''; }
+			if (JSInit) libInits[JSLib] = JSInit + libInits[JSLib];
 			libEvals[JSLib] += 'JSFUNC("~' + JSName + '~",((' + JSArgs + ')=>' + JSCode + '),'+splitTag+');';
-			imports += (JSInit ? JSInit + ';' : '') + JSCode + ';';
+			imports += JSCode + ';';
 		});
 
+	for (let JSLib in libEvals)
+	{
+		if (!libInits[JSLib]) continue;
+		let init = ShakeLibInit(libInits[JSLib], libEvals[JSLib], JSLib);
+		libEvals[JSLib] = init + ';' + libEvals[JSLib];
+		imports += init + ';';
+	}
+
 	if (p.minify)
 	{
 		VERBOSE('    [WASM] Minifying function code');
@@ -926,6 +1240,35 @@ function GenerateWasm(p)
 	return p.wasm;
 }
 
+// Init code of a WAJIC library can be split into fragments that start with a "#Name1,Name2"; marker statement
+// A fragment is only kept if one of its names is used by the library functions or by another part of the init code that is kept
+// Code in front of the first marker or after an empty "#"; marker is always kept
+function ShakeLibInit(init, code, JSLib)
+{
+	var parts = init.split(/["']#([\w,]*)["']\s*;/), res = [ parts[0] ], frags = [], used = code + parts[0], found;
+	if (parts.length == 1) return init;
+	for (var i = 1; i < parts.length; i += 2)
+	{
+		if (!parts[i]) { res.push(parts[i+1]); used += parts[i+1]; continue; }
+		frags.push({ idx: res.length, names: parts[i], find: new RegExp('\\b(' + parts[i].replace(/,/g, '|') + ')\\b') });
+		res.push('');
+		res.push(parts[i+1]);
+	}
+	do
+	{
+		found = false;
+		for (var f of frags)
+		{
+			if (f.keep || !f.find.test(used)) continue;
+			f.keep = found = true;
+			used += res[f.idx + 1];
+		}
+	} while (found);
+	for (var f of frags) if (!f.keep) res[f.idx + 1] = '';
+	VERBOSE('      [WASM WAJIC] ' + (JSLib ? 'Lib ' + JSLib + ' ' : '') + 'Init - Keeping ' + frags.filter(f => f.keep).length + ' of ' + frags.length + ' fragments' + (frags.some(f => !f.keep) ? ' (removed ' + frags.filter(f => !f.keep).map(f => f.names).join(', ') + ')' : ''));
+	return res.join('');
+}
+
 function VerifyWasmLayout(exports, mods, imports, use_memory, p)
 {
 	var has_main_with_args = !!exports.main || !!exports.__main_argc_argv;
@@ -939,9 +1282,13 @@ function VerifyWasmLayout(exports, mods, imports, use_memory, p)
 	var use_MStrAlloc = (use_MStrPut && imports.match(/\bMStrPut\([^,\)]+\)/));
 	var use_MStrGet = imports.match(/\bMStrGet\b/) || use_wasi;
 	var use_MArrPut = imports.match(/\bMArrPut\b/);
+	var use_MStrPutTemp = imports.match(/\bMStrPutTemp\b/);
+	var use_MArrPutTemp = imports.match(/\bMArrPutTemp\b/);
+	var use_MTemp = use_MStrPutTemp || use_MArrPutTemp;
+	var use_MView = imports.match(/\bMView\b/);
 	var use_WM = imports.match(/\bWM\b/);
-	var use_ASM = imports.match(/\bASM\b/) || use_MStrPut || use_MArrPut;
-	var use_MU8 = imports.match(/\bMU8\b/) || use_MStrPut || use_MStrGet || use_MArrPut || (has_main_with_args && has_malloc);
+	var use_ASM = imports.match(/\bASM\b/) || use_MStrPut || use_MArrPut || use_MTemp;
+	var use_MU8 = imports.match(/\bMU8\b/) || use_MStrPut || use_MStrGet || use_MArrPut || use_MTemp || (has_main_with_args && has_malloc);
 	var use_MU16 = imports.match(/\bMU16\b/);
 	var use_MU32 = imports.match(/\bMU32\b/) || (has_main_with_args && has_malloc) || use_wasi;
 	var use_MI32 = imports.match(/\bMI32\b/);
@@ -949,13 +1296,14 @@ function VerifyWasmLayout(exports, mods, imports, use_memory, p)
 	var use_MSetViews = use_MU8 || use_MU16 || use_MU32 || use_MI32 || use_MF32;
 	var use_MEM = use_sbrk || use_MSetViews;
 	var use_TEMP = mods.env.getTempRet0 || mods.env.setTempRet0;
-	var use_malloc = imports.match(/\bASM.malloc\b/i) || use_MArrPut || use_MStrAlloc;
-	var use_free = imports.match(/\bASM.free\b/i);
+	var use_malloc = imports.match(/\bASM.malloc\b/i) || use_MArrPut || use_MStrAlloc || use_MTemp;
+	var use_free = imports.match(/\bASM.free\b/i) || use_MTemp;
 
 	VERBOSE('    [JS] Uses: ' + ([ use_memory?'Memory':0, use_sbrk?'sbrk':0, (has_main_with_args||has_main_no_args)?'main':0, has_WajicMain?'WajicMain':0, use_wasi?'wasi':0 ].filter(m=>m).join('|')));
 	if (!use_memory && use_MEM)       ABORT('WASM module does not import or export memory object but requires memory manipulation');
 	if (!has_malloc && use_MArrPut)   ABORT('WASM module does not export malloc but its usage of MArrPut requires it');
 	if (!has_malloc && use_MStrAlloc) ABORT('WASM module does not export malloc but its usage of MStrPut requires it');
+	if (!has_free   && use_MTemp)     ABORT('WASM module does not export free but its usage of MStrPutTemp/MArrPutTemp requires it');
 	if (!has_malloc && use_malloc)    ABORT('WASM module does not export malloc but it requires it');
 	if (!has_free   && use_free)      ABORT('WASM module does not export free but it requires it');
 
@@ -972,7 +1320,7 @@ function VerifyWasmLayout(exports, mods, imports, use_memory, p)
 		if (unused_free)   WARN('WASM module exports free but does not use it, it should be compiled without the export');
 	}
 
-	return [use_sbrk, use_MStrPut, use_MStrGet, use_MArrPut, use_WM, use_ASM, use_MU8, use_MU16, use_MU32, use_MI32, use_MF32, use_MSetViews, use_MEM, use_TEMP];
+	return [use_sbrk, use_MStrPut, use_MStrGet, use_MArrPut, use_MStrPutTemp, use_MArrPutTemp, use_WM, use_ASM, use_MU8, use_MU16, use_MU32, use_MI32, use_MF32, use_MSetViews, use_MEM, use_TEMP, use_MView];
 }
 
 function MinifyJs(jsBytes, p)
@@ -983,6 +1331,117 @@ function MinifyJs(jsBytes, p)
 	return WriteUTF8String(res.code);
 }
 
+// Break down the output size into wasm functions, data segments, embedded files, WAJIC libraries and the loader boilerplate
+function SizeReport(wasm, wasmOut, jsOut, symbols, p)
+{
+	function Get() { for (var b, r, x = 0; r |= ((b = wasm[i++])&127)<<x, b>>7; x += 7); return r; }
+	function GetString() { var n = Get(), r = ReadUTF8String(wasm, i, n); i += n; return r; }
+	var sectionNames = [ 'custom', 'type', 'import', 'function', 'table', 'memory', 'global', 'export', 'start', 'element', 'code', 'data', 'datacount' ];
+	var res = { outputs: { wasm: (wasmOut ? wasmOut.length : 0), js: (jsOut ? jsOut.length : 0) }, sections: [], functions: [], data: [], files: [], libs: [], loader: 0 };
+	var funcImports = 0, names = {};
+
+	for (var i = 8, iSectionStart, iSectionEnd, type, len; i < wasm.length; i = iSectionEnd)
+	{
+		iSectionStart = i, type = Get(), len = Get(), iSectionEnd = i + len;
+		var name = sectionNames[type] || ('unknown' + type);
+		if (type == 0)
+		{
+			name = GetString();
+			if (name[0] == '|') { if (!p.embeds[name.substr(1)]) res.files.push({ name: name.substr(1), bytes: iSectionEnd - iSectionStart }); continue; }
+			if (name == 'name')
+				for (var sub, subEnd; i < iSectionEnd; i = subEnd)
+				{
+					sub = wasm[i++], subEnd = Get(), subEnd += i;
+					if (sub == 1) for (var n = Get(); n--;) { var idx = Get(); names[idx] = GetString(); }
+				}
+			name = 'custom ' + name;
+		}
+		else if (type == 2)
+		{
+			for (var n = Get(); n--;)
+			{
+				GetString(); GetString();
+				var kind = wasm[i++];
+				if      (kind == 0) { Get(); funcImports++; }
+				else if (kind == 1) { i++; if (Get() & 1) Get(); Get(); }
+				else if (kind == 2) { if (Get() & 1) Get(); Get(); }
+				else if (kind == 3) { i += 2; }
+			}
+		}
+		else if (type == 10)
+		{
+			for (var n = Get(), j = 0; j != n; j++)
+			{
+				var start = i, size = Get();
+				res.functions.push({ index: funcImports + j, name: '', bytes: size + i - start });
+				i += size;
+			}
+		}
+		else if (type == 11)
+		{
+			for (var n = Get(), j = 0; j != n; j++)
+			{
+				var start = i, flags = Get(), offset = -1;
+				if (flags == 2) Get();
+				if (flags != 1) { if (wasm[i] == 0x41) { i++; offset = Get(); } while (wasm[i++] != 0x0B); }
+				var size = Get();
+				res.data.push({ index: j, offset: offset, bytes: size + i - start });
+				i += size;
+			}
+		}
+		res.sections.push({ name: name, bytes: iSectionEnd - iSectionStart });
+	}
+	for (var f of res.functions) f.name = symbols[f.index] || names[f.index] || ('func' + f.index);
+	for (var name in p.embeds) res.files.push({ name: name, bytes: p.embeds[name].length });
+	res.named = !!Object.keys(symbols).length || !!Object.keys(names).length;
+
+	// Size of the JavaScript code of each WAJIC library before and after minification (measured inside the output wasm when it keeps the code)
+	var libs = {}, Lib = (JSLib => libs[JSLib] || (libs[JSLib] = { name: JSLib || '(no lib)', functions: 0, bytes: 0, minified: 0, inits: [], code: [] }));
+	WasmProcessImports(wasm, false, () => 0, (JSLib, JSName, JSArgs, JSCode, JSInit) =>
+	{
+		var lib = Lib(JSLib);
+		if (JSInit && !lib.inits.includes(JSInit)) { lib.inits.push(JSInit); lib.bytes += JSInit.length; }
+		lib.code.push(NumberToAlphabet(lib.functions++) + ':(' + JSArgs + ') => ' + JSCode);
+		lib.bytes += JSName.length + JSArgs.length + JSCode.length;
+	});
+	if (wasmOut && !jsOut)
+	{
+		WasmProcessImports(wasmOut, false, () => 0, (JSLib, JSName, JSArgs, JSCode, JSInit) =>
+			{ Lib(JSLib).minified += JSName.length + JSArgs.length + JSCode.length + (JSInit ? JSInit.length : 0); });
+	}
+	else for (var JSLib in libs)
+	{
+		var lib = libs[JSLib], code = lib.code.join(",\n"), src = 'J.x=(function(){' + ShakeLibInit(lib.inits.join(";\n"), code, JSLib) + ';\nreturn {' + code + '};})();';
+		var min = (p.minify ? p.terser.minify(src, p.terser_options_reserve) : { code: src });
+		lib.minified = (min.error ? src : min.code).length - 'J.x=(function(){return {};})();'.length;
+	}
+	for (var JSLib in libs) { var lib = libs[JSLib]; res.libs.push({ name: lib.name, functions: lib.functions, bytes: lib.bytes, minified: lib.minified }); }
+
+	// What remains of the JavaScript output after the libraries and the embedded wasm file is the loader code
+	if (jsOut)
+	{
+		var wasmString = (p.wasmPath ? 0 : (p.rle ? EncodeRLE85(p.wasm) : p.base64 ? EncodeBase64(p.wasm) : EncodeW64(p.wasm)).length);
+		res.embedded_wasm = wasmString;
+		res.loader = Math.max(0, jsOut.length - wasmString - res.libs.reduce((a, l) => a + l.minified, 0));
+	}
+
+	// List the largest contributors
+	var sum = (a, k) => a.reduce((n, x) => n + x[k], 0), list = [];
+	res.functions.forEach(f => list.push({ kind: 'function', name: f.name, bytes: f.bytes }));
+	res.data.forEach(d => list.push({ kind: 'data', name: 'segment ' + d.index + (d.offset >= 0 ? ' at ' + d.offset : ''), bytes: d.bytes }));
+	res.files.forEach(f => list.push({ kind: 'file', name: f.name, bytes: f.bytes }));
+	res.libs.forEach(l => list.push({ kind: 'js lib', name: l.name + ' (' + l.functions + ' functions, ' + l.bytes + ' before minify)', bytes: l.minified }));
+	res.sections.forEach(s => s.name != 'code' && s.name != 'data' && s.name != 'import' && list.push({ kind: 'section', name: s.name, bytes: s.bytes }));
+	if (res.loader) list.push({ kind: 'loader', name: 'loader boilerplate', bytes: res.loader });
+	res.top = list.sort((a, b) => b.bytes - a.bytes).slice(0, 20);
+
+	console.log('  [SIZE] Input wasm: ' + wasm.length + ' bytes - code ' + sum(res.functions, 'bytes') + ' (' + res.functions.length + ' functions), data ' + sum(res.data, 'bytes') + ' (' + res.data.length + ' segments), files ' + sum(res.files, 'bytes') + ' (' + res.files.length + ')');
+	console.log('  [SIZE] WAJIC libraries: ' + sum(res.libs, 'bytes') + ' bytes of JavaScript, ' + sum(res.libs, 'minified') + ' bytes ' + (jsOut ? 'after minification' : 'in the output wasm') + (jsOut ? ' - Loader: ' + res.loader + ' bytes' + (res.embedded_wasm ? ' - Embedded wasm: ' + res.embedded_wasm + ' bytes' : '') : ''));
+	console.log('  [SIZE] Largest contributors:');
+	res.top.forEach(e => console.log(('          ' + e.bytes).slice(-10) + '  ' + (e.kind + '          ').slice(0, 10) + e.name));
+	return res;
+}
+
 function ReadUTF8String(buf, idx, length)
 {
 	if (!buf || length === 0) return '';
@@ -1125,6 +1584,58 @@ function WasmFindHeapBase(wasm, memory_pages)
 	return (found ? found : findMax);
 }
 
+// Move large active data segments into the custom section 'wajic_data' compressed with deflate (restored into memory by the loader)
+// The segments are left in place with a length of zero so the segment indices stay the same
+function WasmCompressData(wasm, p)
+{
+	if (!p.compressdata) return wasm;
+	function Get() { for (var b, r, x = 0; r |= ((b = wasm[i++])&127)<<x, b>>7; x += 7); return r; }
+	function GetS() { for (var b, r = 0, x = 0; r |= ((b = wasm[i++])&127)<<x, x += 7, b>>7;); return (x < 32 && (b & 64) ? r | (-1 << x) : r); }
+	var wasmNew = { arr: new Uint8Array(wasm.length), len: 8 }, segs = [], datas = [], total = 0;
+	wasmNew.arr.set(wasm.subarray(0, 8));
+	for (var i = 8, iSectionStart, iSectionEnd, type, len; i < wasm.length; i = iSectionEnd)
+	{
+		iSectionStart = i, type = Get(), len = Get(), iSectionEnd = i + len;
+		if (type != 11) { AppendBuf(wasmNew, wasm.subarray(iSectionStart, iSectionEnd)); continue; }
+
+		var sec = { arr: new Uint8Array(len), len: 0 };
+		AppendLEB(sec, Get());
+		while (i < iSectionEnd)
+		{
+			var iSegStart = i, flags = Get(), offset = -1, iSize, size;
+			if (flags == 0 && wasm[i] == 0x41) { i++; offset = GetS() >>> 0; if (wasm[i] != 0x0B) offset = -1; }
+			if (flags == 2) Get();
+			if (flags != 1) while (wasm[i++] != 0x0B);
+			iSize = i, size = Get(), i += size;
+			if (offset < 0 || size < 1024) { AppendBuf(sec, wasm.subarray(iSegStart, i)); continue; }
+			AppendBuf(sec, wasm.subarray(iSegStart, iSize));
+			AppendLEB(sec, 0);
+			segs.push([offset, size]);
+			datas.push(wasm.subarray(i - size, i));
+			total += size;
+		}
+		AppendLEB(wasmNew, 11);
+		AppendLEB(wasmNew, sec.len);
+		AppendBuf(wasmNew, sec.arr.subarray(0, sec.len));
+	}
+	if (!segs.length) { WARN('There are no data segments larger than 1 kb to compress'); return wasm; }
+
+	var data = require('zlib').deflateSync(Buffer.concat(datas), { level: 9 }), head = { arr: new Uint8Array(64), len: 0 }, nameBuf = WriteUTF8String('wajic_data');
+	AppendLEB(head, segs.length);
+	segs.forEach(s => { AppendLEB(head, s[0]); AppendLEB(head, s[1]); });
+	if (data.length + head.len + 16 >= total) { WARN('Compressing the data segments does not reduce the size (' + total + ' bytes), keeping them uncompressed'); return wasm; }
+
+	AppendLEB(wasmNew, 0);
+	AppendLEB(wasmNew, LengthLEB(nameBuf.length) + nameBuf.length + head.len + data.length);
+	AppendLEB(wasmNew, nameBuf.length);
+	AppendBuf(wasmNew, nameBuf);
+	AppendBuf(wasmNew, head.arr.subarray(0, head.len));
+	AppendBuf(wasmNew, data);
+	console.log('  [DATA] Compressed ' + segs.length + ' data segment' + (segs.length != 1 ? 's' : '') + ' from ' + total + ' to ' + data.length + ' bytes');
+	p.dataCompressed = true;
+	return wasmNew.arr.subarray(0, wasmNew.len);
+}
+
 function WasmEmbedFiles(wasm, embeds)
 {
 	if (!embeds || !Object.keys(embeds).length) return wasm;
@@ -1181,6 +1692,16 @@ function WasmProcessImports(wasm, logImports, callbackImportMod, callbackImportJ
 					if (JSCode === undefined) ABORT('This WASM module contains no body for the WAJIC function "' + fld + '". It was probably already processed with this tool.');
 					if (!JSLib) JSLib = '';
 
+					// turn typed array and index annotations (like 'float* WA_F32ARRAY(p, n)') into code at the start of the function
+					let JSPre = '';
+					JSArgs = JSArgs.replace(/WA_(U8|U16|U32|I32|F32)ARRAY\(([^,]*),((?:[^()]|\([^()]*\))*)\)|WA_INDEX(16|32)\(([^)]*)\)/g, (m, heap, arr, len, bits, idx) =>
+					{
+						let shift = (heap ? Math.log2(heap.slice(1) / 8) : bits / 16);
+						JSPre += (heap ? (arr = arr.trim()) + '=MView(M' + heap + ',' + arr + (shift ? '>>' + shift : '') + ',' + len + ');' : (idx = idx.trim()) + '>>=' + shift + ';');
+						return arr || idx;
+					});
+					if (JSPre) JSCode = (JSCode.match(/^\s*{/) ? JSCode.replace('{', '{' + JSPre) : '{' + JSPre + 'return(' + JSCode + ')}');
+
 					// strip C types out of params list (change '(float* p1, unsigned int p2[4], WAu64 i)' to 'p1,p2,i1,i2' (function pointers not supported)
 					JSArgs = JSArgs
 						.replace(/^\(\s*void\s*\)$|^\(|\[.*?\]|(=|WA_ARG\()[^,]+|\)$/g, '') // remove a single void, opening/closing brackets, array and default argument suffixes
@@ -1315,15 +1836,16 @@ function NumberToAlphabet(num)
 
 function EncodeW64(buf)
 {
-	var bufLen = buf.length, res = '', i = 0, n;
-	var Get = (x => buf[i++]<<x);
-	var Add = (x => res += String.fromCharCode(x < (92 - 58) ? x + 58 : x + 58 + 1));
+	// Fill a byte buffer with 4 characters for every 3 bytes (using the 64 characters from ':' to 'z' except '\\')
+	var bufLen = buf.length, out = new Uint8Array(Math.ceil(bufLen/3)*4), i = 0, o = 0, n;
+	var T = new Uint8Array(64).map((x, y) => (y < (92 - 58) ? y + 58 : y + 58 + 1));
 	while (i < bufLen)
 	{
-		n = Get(0)|Get(8)|Get(16);
-		Add(n&63), Add((n>>6)&63), Add((n>>12)&63), Add((n>>18)&63)
+		n = buf[i++]|buf[i++]<<8|buf[i++]<<16;
+		out[o++] = T[n&63], out[o++] = T[(n>>6)&63], out[o++] = T[(n>>12)&63], out[o++] = T[n>>18];
 	}
-	return ((bufLen%3) ? res.slice(0,-1)+(3-(bufLen%3)) : res);
+	if (bufLen%3) out[o-1] = 48 + 3 - (bufLen%3); // last character is the number of padding bytes
+	return ReadUTF8String(out);
 }
 
 function DecodeW64(str)
@@ -1331,17 +1853,29 @@ function DecodeW64(str)
 	//Unused by this program, but left here unminified as reference
 	var strLen = str.length, pad = str[strLen-1], i = 0, o = 0, n, U8 = Uint8Array;
 	var T = new U8(128).map((x,y) => (y < 92 ? y - 58 : y - 59));
-	var a = new U8(strLen/4*3-(pad<3&&pad));
-	var Get = (x => T[str.charCodeAt(i++)]<<x);
-	var Add = (x => a[o++] = n>>x);
+	var s = new TextEncoder().encode(str), a = new U8(strLen/4*3-(pad<3&&pad));
 	while (i < strLen)
 	{
-		n = Get(0)|Get(6)|Get(12)|Get(18);
-		Add(0),Add(8),Add(16)
+		n = T[s[i++]]|T[s[i++]]<<6|T[s[i++]]<<12|T[s[i++]]<<18;
+		a[o++] = n, a[o++] = n>>8, a[o++] = n>>16;
 	}
 	return a;
 }
 
+function EncodeBase64(buf)
+{
+	// Standard base64 with padding (same method as EncodeW64 but with the most significant bits first)
+	var bufLen = buf.length, out = new Uint8Array(Math.ceil(bufLen/3)*4), i = 0, o = 0, n;
+	var T = WriteUTF8String('ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/');
+	while (i < bufLen)
+	{
+		n = buf[i++]<<16|buf[i++]<<8|buf[i++];
+		out[o++] = T[n>>18], out[o++] = T[(n>>12)&63], out[o++] = T[(n>>6)&63], out[o++] = T[n&63];
+	}
+	if (bufLen%3) out.fill(61, o - 3 + (bufLen%3)); // '=' padding
+	return ReadUTF8String(out);
+}
+
 function EncodeRLE85(src, compressionLevel = 10)
 {
 	var res = '';
@@ -1496,12 +2030,19 @@ function ExperimentalCompileWasm(p, wasmPath, cfiles, ccAdd, ldAdd, pathToWajic,
 			child_process.spawnSync(process.execPath,['-e','setTimeout(function(){},100)']); //sleep 100 ms
 		}
 	}
+	// Temporary files get deleted at the end of each build, the ones still left after an abort get deleted on exit
+	var temps = ExperimentalCompileWasm.temps;
+	if (!temps) { temps = ExperimentalCompileWasm.temps = []; process.on('exit', () => DeleteTemps(temps.slice())); }
 	function GetTempPath(base, ext)
 	{
 		do { var path = 'tmp-wajic-' + base + '-' + ((Math.random()*1000000)|0) + '.' + ext; } while (fs.existsSync(path));
-		process.on('exit', function() { try { fs.unlinkSync(path); } catch (e) {} });
+		temps.push(path);
 		return path;
 	}
+	function DeleteTemps(paths)
+	{
+		paths.forEach(path => { try { fs.unlinkSync(path); } catch (e) {} var i = temps.indexOf(path); if (i >= 0) temps.splice(i, 1); });
+	}
 
 	var clangCmd   = pathToWajic + 'clang';
 	var ldCmd      = pathToWajic + 'wasm-ld';
@@ -1520,40 +2061,67 @@ function ExperimentalCompileWasm(p, wasmPath, cfiles, ccAdd, ldAdd, pathToWajic,
 	else ccArgs.push('-DNDEBUG', '-Os'); //default optimizations
 	ccArgs = ccArgs.concat(ccAdd.trim().split(/\s+/));
 
+	// Link the component archives of the system library built by wajic.mk if available, otherwise the prebuilt system.bc
+	// With LTO the objects are LLVM bitcode and get optimized together with the bitcode archives which are required
+	var systemLibDir = pathToSystem + 'libs' + (p.lto ? '-lto-' + p.lto : '') + '/';
+	var systemLibs = ['libc.a', 'libc++.a', 'libc++abi.a', 'libcompiler_rt.a', 'libmalloc.a'].map(f => systemLibDir + f);
+	if (!systemLibs.every(f => fs.existsSync(f)))
+	{
+		if (p.lto) ABORT('Missing system library for LTO in ' + systemLibDir + "\n" + 'Build it with: make -f wajic.mk LTO=' + p.lto + ' system');
+		systemLibs = [ pathToSystem + 'system.bc' ];
+	}
+	if (p.lto) ccArgs.push('-emit-llvm-bc', '-flto=' + p.lto, '-flto-unit');
+
 	var ldArgs = (wantDebug ? [] : ['-strip-all']);
-	ldArgs.push('-gc-sections', '-no-entry', '-allow-undefined', '-export=__wasm_call_ctors', '-export=main', '-export=__original_main', '-export=__main_argc_argv', '-export=__main_void', '-export=malloc', '-export=free', pathToSystem+'system.bc');
+	ldArgs.push('-gc-sections', '-no-entry', '-allow-undefined', '-export=__wasm_call_ctors', '-export=main', '-export=__original_main', '-export=__main_argc_argv', '-export=__main_void', '-export=malloc', '-export=free', ...systemLibs);
 	ldArgs = ldArgs.concat(ldAdd.trim().split(/\s+/));
 
-	var procs = [];
-	cfiles.forEach((f,i) =>
+	// The slab allocator is implemented in a header and replaces the malloc/free functions of the system library
+	if (p.allocator == 'slab') cfiles = cfiles.concat(pathToWajic + 'wajic_alloc.h');
+
+	// Delete the objects and the temporary output even when a step fails (ABORT throws while watching)
+	var procs = [], objPaths = [], tempWasm = !wasmPath;
+	if (tempWasm) wasmPath = GetTempPath('out', 'wasm');
+	try
 	{
-		var isC = (f.match(/\.c$/i)), outPath = GetTempPath(f.match(/([^\/\\]*?)\.[^\.\/\\]+$/)[1], 'o');
-		var args = ccArgs.concat(hasX ? [] : ['-x', (isC ? 'c' : 'c++')]).concat(hasStd ? [] : ['-std=' + (isC ? 'c99' : 'c++11')]);
-		if (!wantRtti && !isC) args.push('-fno-rtti');
-		args.push('-o', outPath, f);
-		console.log('  [COMPILE] Compiling file: ' + f + ' ...');
-		(i == cfiles.length - 1 ? Run : RunAsync)(clangCmd, args, "COMPILE", outPath, procs, 4);
-		ldArgs.push(outPath);
-	});
-	WaitProcs(procs);
+		cfiles.forEach((f,i) =>
+		{
+			var isC = (f.match(/\.[ch]$/i)), outPath = GetTempPath(f.match(/([^\/\\]*?)\.[^\.\/\\]+$/)[1], 'o');
+			var args = ccArgs.concat(hasX ? [] : ['-x', (isC ? 'c' : 'c++')]).concat(hasStd ? [] : ['-std=' + (isC ? 'c99' : 'c++11')]);
+			if (!wantRtti && !isC) args.push('-fno-rtti');
+			if (f.match(/\.h$/i)) args.push('-DWA_ALLOC_IMPLEMENTATION');
+			args.push('-o', outPath, f);
+			console.log('  [COMPILE] Compiling file: ' + f + ' ...');
+			objPaths.push(outPath);
+			(i == cfiles.length - 1 ? Run : RunAsync)(clangCmd, args, "COMPILE", outPath, procs, 4);
+			ldArgs.push(outPath);
+		});
+		WaitProcs(procs);
+
+		console.log('  [LINKING] Linking files: ' + cfiles.join(', ') + ' ...');
+		ldArgs.push('-o', wasmPath);
+		Run(ldCmd, ldArgs, "LINKING");
 
-	console.log('  [LINKING] Linking files: ' + cfiles.join(', ') + ' ...');
-	if (!wasmPath) wasmPath = GetTempPath('out', 'wasm');
-	ldArgs.push('-o', wasmPath);
-	Run(ldCmd, ldArgs, "LINKING");
+		try { var buf = fs.readFileSync(wasmPath); } catch (e) { return ABORT('Failed to load file: ' + wasmPath, e); }
+	}
+	finally { DeleteTemps(tempWasm ? objPaths.concat(wasmPath) : objPaths); }
 
 	p.RunWasmOpt = function(unused_malloc, unused_free)
 	{
 		if (unused_malloc || unused_free) p.wasm = WasmFilterExports(p.wasm, {malloc:unused_malloc,free:unused_free});
 		if (wantDebug) return;
-		fs.writeFileSync(wasmPath, p.wasm);
-		// adding '--ignore-implicit-traps' would be nice but it can break programs with '-Os'(see issue binaryen-2824)
-		var wasmOptArgs = ['--legalize-js-interface', '--low-memory-unused', '--converge', '-Os', wasmPath, '-o', wasmPath ];
-		Run(wasmOptCmd, wasmOptArgs, "WASMOPT");
-		p.wasm = new Uint8Array(fs.readFileSync(wasmPath));
+		if (tempWasm) temps.push(wasmPath);
+		try
+		{
+			fs.writeFileSync(wasmPath, p.wasm);
+			// adding '--ignore-implicit-traps' would be nice but it can break programs with '-Os'(see issue binaryen-2824)
+			var wasmOptArgs = ['--legalize-js-interface', '--low-memory-unused', '--converge', '-Os', wasmPath, '-o', wasmPath ];
+			Run(wasmOptCmd, wasmOptArgs, "WASMOPT");
+			p.wasm = new Uint8Array(fs.readFileSync(wasmPath));
+		}
+		finally { if (tempWasm) DeleteTemps([wasmPath]); }
 	};
 
-	try { var buf = fs.readFileSync(wasmPath); } catch (e) { return ABORT('Failed to load file: ' + wasmPath, e); }
 	console.log('  [LOADED] ' + wasmPath + ' (' + buf.length + ' bytes)');
 	return new Uint8Array(buf);
 }